@@ -0,0 +1,103 @@
+// Measures the overhead of the framework itself with all output going to a null stream. Every change to the
+// framework should be evaluated against these numbers. Arguments like --cold-start or --benchmark-report are
+// passed on to the test app.
+
+#include "test.h"
+
+namespace{
+
+constexpr auto numRegisteredTestCases = 1'000'000;
+constexpr auto numLookupTestCases     = 1'000;
+
+void addFrameworkBenchmarks(test::TestApp& app)
+{
+	auto output   = std::make_shared<test::NullStream>();
+	auto logger   = std::make_shared<test::ResultLogger>(*output, *output);
+	auto executor = std::make_shared<test::TestExecutor>();
+	auto suite    = std::make_shared<test::TestSuite<int>>("framework", [](int value){ test::doNotOptimize(value); });
+
+	for(int i = 0; i < numLookupTestCases; ++i)
+		suite->addTestCase(std::to_string(i), int(i));
+
+	app.addBenchmark("framework/check", [value = 42]() mutable
+	{
+		test::doNotOptimize(value);
+		test::check(value == 42);
+	});
+
+	app.addBenchmark("framework/compare", [value = 42]() mutable
+	{
+		test::doNotOptimize(value);
+		test::compare(value, 42);
+	});
+
+	app.addBenchmark("framework/check(that)", [value = 42]() mutable
+	{
+		test::doNotOptimize(value);
+		test::check(test::that(value) == 42);
+	});
+
+	app.addBenchmark("framework/doNotOptimize", []()
+	{
+		auto value = 42;
+		auto text  = std::string("doNotOptimize");
+		test::doNotOptimize(value);
+		test::doNotOptimize(text);
+	});
+
+	app.addBenchmark("framework/execute", [output, logger, executor]()
+	{
+		executor->execute("framework", "execute", [](){}, *logger);
+	});
+
+	// The name is built up front so only the lookup itself is measured
+	app.addBenchmark("framework/executeTestCase by name of " + std::to_string(numLookupTestCases),
+		[output, logger, executor, suite, name = std::to_string(numLookupTestCases - 1)]()
+	{
+		suite->executeTestCase(*executor, name, *logger);
+	});
+
+	app.addBenchmark("framework/addTestCase x" + std::to_string(numRegisteredTestCases), []()
+	{
+		auto testSuite = test::TestSuite<int>("framework", [](int){});
+
+		for(int i = 0; i < numRegisteredTestCases; ++i)
+			testSuite.addTestCase("case", int(i));
+
+		test::doNotOptimize(testSuite);
+	});
+
+	app.addBenchmark("framework/logRunningTest", [output, logger]()
+	{
+		logger->logRunningTest("framework", "logRunningTest");
+	});
+
+#if TEST_EXCEPTIONS
+	app.addBenchmark("framework/failure formatting", [value = 42]() mutable
+	{
+		test::doNotOptimize(value);
+
+		try
+		{
+			test::compare(value, 43);
+		}
+		catch(const test::TestFailure& failure)
+		{
+			test::doNotOptimize(failure.message());
+		}
+	});
+#endif
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	auto app = test::TestApp();
+	addFrameworkBenchmarks(app);
+
+	auto args = std::vector<const char*>(argv, argv + argc);
+	args.insert(args.begin() + std::min(argc, 1), "--benchmark");
+
+	return app.main(static_cast<int>(args.size()), args.data());
+}
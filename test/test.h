@@ -1,29 +1,158 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <cinttypes>
 #include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <filesystem>
 #include <format>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <set>
 #include <source_location>
 #include <span>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <typeinfo>
 #include <utility>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define TEST_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#else
+#define TEST_POSIX 0
+#endif
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+// Keeps failure reporting out of the hot path of assertions
+#if defined(__GNUC__) || defined(__clang__)
+#define TEST_COLD [[gnu::cold, gnu::noinline]]
+#elif defined(_MSC_VER)
+#define TEST_COLD __declspec(noinline)
+#else
+#define TEST_COLD
+#endif
+
+// Without exceptions failures end the test case by terminating the process it runs in, see TestExecutor
+#ifndef TEST_EXCEPTIONS
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+#define TEST_EXCEPTIONS 1
+#else
+#define TEST_EXCEPTIONS 0
+#endif
+#endif
+
+// Static tracepoints for profilers like bpftrace and perf, each compiles to a single nop while no tracer is attached.
+// Strings are passed as pointer and size, e.g. usdt:./tests:test:case_start { printf("%s\n", str(arg2, arg3)); }
+#if defined(__has_include) && !defined(TEST_NO_PROBES)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TEST_PROBE(name, ...) STAP_PROBEV(test, name, __VA_ARGS__)
+#endif
+#endif
+
+#ifndef TEST_PROBE
+#define TEST_PROBE(name, ...)
+#endif
+
+// Define TEST_IMPACT_ANALYSIS and compile with -finstrument-functions -g to record which source files each test case executes
+#ifdef TEST_IMPACT_ANALYSIS
+#if !TEST_POSIX || !defined(__ELF__)
+#error "TEST_IMPACT_ANALYSIS requires an ELF platform"
+#endif
+#include <dlfcn.h>
+#include <link.h>
+#define TEST_NO_INSTRUMENT [[gnu::no_instrument_function]]
+#endif
+
 namespace test{
 
+// Entry of a thread local stack of context information that is only formatted when a failure occurs
+class InfoScope{
+public:
+	InfoScope(const InfoScope&) = delete;
+	InfoScope& operator=(const InfoScope&) = delete;
+
+	// Describes all scopes active on the current thread, outermost first
+	static auto describeAll() -> std::string
+	{
+		auto scopes = std::vector<const InfoScope*>();
+
+		for(const auto* scope = current(); scope; scope = scope->m_previous)
+			scopes.push_back(scope);
+
+		auto result = std::string();
+
+		for(auto it = scopes.rbegin(); it != scopes.rend(); ++it)
+			result += "\n\twith " + (*it)->m_format(**it);
+
+		return result;
+	}
+
+protected:
+	using FormatFunc = std::string(*)(const InfoScope&);
+
+	explicit InfoScope(FormatFunc format)
+		: m_format{format}
+		, m_previous{current()}
+	{
+		current() = this;
+	}
+
+	~InfoScope()
+	{
+		current() = m_previous;
+	}
+
+private:
+	FormatFunc       m_format;
+	const InfoScope* m_previous;
+
+	static auto current() -> const InfoScope*&
+	{
+		thread_local const InfoScope* top = nullptr;
+		return top;
+	}
+};
+
 class TestFailure{
 public:
 	TestFailure(std::string message, std::source_location location = std::source_location::current())
-		: m_message{std::move(message)}
+		: m_message{std::move(message) + InfoScope::describeAll()}
 		, m_location{location}
 	{
 	}
@@ -36,13 +165,54 @@ private:
 	std::source_location m_location;
 };
 
+template<typename Exception>
+[[noreturn]]
+void throwException(const Exception& e)
+{
+#if TEST_EXCEPTIONS
+	throw e;
+#else
+	std::cerr << "ERROR: " << e.what() << std::endl;
+	std::abort();
+#endif
+}
+
+#if !TEST_EXCEPTIONS
+// Write end of the pipe to the parent process when running inside an isolated test case
+inline auto failureChannel() -> int&
+{
+	thread_local auto fd = -1;
+	return fd;
+}
+#endif
+
 [[noreturn]]
 inline void fail(std::string_view message, std::source_location location = std::source_location::current())
 {
+	TEST_PROBE(failure, message.data(), message.size(), location.file_name(), location.line());
+
+#if TEST_EXCEPTIONS
 	throw TestFailure(std::string(message), location);
+#else
+	const auto failure = TestFailure(std::string(message), location);
+	const auto where   = std::format("{}:{}:{}", location.file_name(), location.line(), location.column());
+
+#if TEST_POSIX
+	if(const auto fd = failureChannel(); fd >= 0)
+	{
+		const auto report = where + '\0' + failure.message();
+		(void)::write(fd, report.data(), report.size());
+		std::cout.flush();
+		::_exit(EXIT_FAILURE);
+	}
+#endif
+
+	std::cerr << "FAIL: " << where << " - " << failure.message() << std::endl;
+	std::abort();
+#endif
 }
 
-inline void check(bool condition, std::string_view message = "Check failed", std::source_location location = std::source_location::current())
+constexpr void check(bool condition, std::string_view message = "Check failed", std::source_location location = std::source_location::current())
 {
 	if(!condition)
 		fail(message, location);
@@ -122,9 +292,52 @@ auto toString(const T& enumValue) -> std::string
 	return "(enum)" + std::to_string(static_cast<std::underlying_type_t<T>>(enumValue));
 }
 
+// Lvalues are referenced and temporaries moved in, functions are called to produce a description, all of them only
+// formatted on failure. Referenced values have to outlive the scope.
+template<typename ...Values>
+class ScopedInfo : public InfoScope{
+public:
+	explicit ScopedInfo(Values&&... values)
+		: InfoScope{&format}
+		, m_values{std::forward<Values>(values)...}
+	{
+	}
+
+private:
+	std::tuple<Values...> m_values;
+
+	template<typename T>
+	static auto formatValue(const T& value) -> std::string
+	{
+		if constexpr(std::invocable<const T&>)
+			return std::string(value());
+		else if constexpr(std::convertible_to<const T&, std::string_view>)
+			return std::string(std::string_view(value));
+		else
+			return toString(value);
+	}
+
+	static auto format(const InfoScope& scope) -> std::string
+	{
+		return std::apply([](const auto&... values)
+		{
+			auto result = std::string();
+			((result += (result.empty() ? "" : " ") + formatValue(values)), ...);
+			return result;
+		}, static_cast<const ScopedInfo&>(scope).m_values);
+	}
+};
+
+// Adds context to failures in the current scope, e.g. 'const auto scope = test::info("input", i);'
+template<typename ...Values>
+[[nodiscard]] auto info(Values&&... values) -> ScopedInfo<Values...>
+{
+	return ScopedInfo<Values...>(std::forward<Values>(values)...);
+}
+
 template<typename A, typename B = A>
 struct Comparator{
-	auto operator()(const A& a, const B& b) const -> bool
+	constexpr auto operator()(const A& a, const B& b) const -> bool
 	{
 		return a == b;
 	}
@@ -132,38 +345,156 @@ struct Comparator{
 
 template<typename A, typename B, typename Comp = Comparator<A, B>>
 requires (!std::ranges::range<A> || !std::ranges::range<B>) || std::convertible_to<const A, std::string_view>
-void compare(A&& actual, B&& expected, Comp&& comp = Comp{}, std::source_location location = std::source_location::current())
+constexpr void compare(A&& actual, B&& expected, Comp&& comp = Comp{}, std::source_location location = std::source_location::current())
 {
-	check(
-		comp(actual, expected),
-		"Comparison failed - actual: " + toString(actual) + ", expected: " + toString(expected),
-		location);
+	if(!comp(actual, expected))
+		fail("Comparison failed - actual: " + toString(actual) + ", expected: " + toString(expected), location);
 }
 
 template<typename A, typename B, typename Comp = Comparator<std::ranges::range_value_t<A>, std::ranges::range_value_t<B>>>
 requires std::ranges::range<A> && std::ranges::range<B> && (!std::convertible_to<const A, std::string_view>)
-void compare(A&& actual, B&& expected, Comp&& comp = Comp{}, std::source_location location = std::source_location::current())
+constexpr void compare(A&& actual, B&& expected, Comp&& comp = Comp{}, std::source_location location = std::source_location::current())
 {
 	const auto actualSize   = std::ranges::size(actual);
 	const auto expectedSize = std::ranges::size(expected);
 
-	check(actualSize == expectedSize,
-	      std::format("size mismatch - actual: {}, expected: {}", actualSize, expectedSize),
-	      location);
+	if(actualSize != expectedSize)
+		fail(std::format("size mismatch - actual: {}, expected: {}", actualSize, expectedSize), location);
 
 	auto aIt = std::ranges::begin(actual);
 	auto bIt = std::ranges::begin(expected);
 
 	for(std::size_t i = 0; i < actualSize; ++i, ++aIt, ++bIt)
 	{
-		check(
-			comp(*aIt, *bIt),
-			"Item mismatch at index " + std::to_string(i) +
+		if(!comp(*aIt, *bIt))
+		{
+			fail("Item mismatch at index " + std::to_string(i) +
 				" - actual: " + toString(actual) + ", expected: " + toString(expected),
-			location);
+				location);
+		}
+	}
+}
+
+template<typename Op>
+constexpr auto operatorSymbol() -> std::string_view
+{
+	if constexpr(std::is_same_v<Op, std::equal_to<>>)
+		return "==";
+	else if constexpr(std::is_same_v<Op, std::not_equal_to<>>)
+		return "!=";
+	else if constexpr(std::is_same_v<Op, std::less<>>)
+		return "<";
+	else if constexpr(std::is_same_v<Op, std::less_equal<>>)
+		return "<=";
+	else if constexpr(std::is_same_v<Op, std::greater<>>)
+		return ">";
+	else
+		return ">=";
+}
+
+// Result of a comparison decomposed by test::that() which keeps the operands to describe a failure
+template<typename L, typename R, typename Op>
+class BinaryExpression{
+public:
+	constexpr BinaryExpression(const L& lhs, const R& rhs)
+		: m_lhs{lhs}
+		, m_rhs{rhs}
+		, m_result{Op()(lhs, rhs)}
+	{
+	}
+
+	[[nodiscard]] constexpr auto result() const -> bool{ return m_result; }
+
+	[[nodiscard]] auto describe() const -> std::string
+	{
+		return describe(m_lhs, m_rhs);
+	}
+
+	constexpr void check(std::source_location location) const
+	{
+		if(!m_result) [[unlikely]]
+			fail(m_lhs, m_rhs, location);
+	}
+
+private:
+	const L& m_lhs;
+	const R& m_rhs;
+	bool     m_result;
+
+	static auto describe(const L& lhs, const R& rhs) -> std::string
+	{
+		return toString(lhs) + ' ' + std::string(operatorSymbol<Op>()) + ' ' + toString(rhs);
+	}
+
+	// Takes the operands instead of the expression so it does not have to be materialized outside of the failure path
+	[[noreturn]] TEST_COLD static void fail(const L& lhs, const R& rhs, std::source_location location)
+	{
+		test::fail("Check failed - " + describe(lhs, rhs), location);
+	}
+};
+
+template<typename L>
+class ExpressionLhs{
+public:
+	explicit constexpr ExpressionLhs(const L& lhs)
+		: m_lhs{lhs}
+	{
+	}
+
+	template<typename R>
+	constexpr auto operator==(const R& rhs) const -> BinaryExpression<L, R, std::equal_to<>>{ return {m_lhs, rhs}; }
+
+	template<typename R>
+	constexpr auto operator!=(const R& rhs) const -> BinaryExpression<L, R, std::not_equal_to<>>{ return {m_lhs, rhs}; }
+
+	template<typename R>
+	constexpr auto operator<(const R& rhs) const -> BinaryExpression<L, R, std::less<>>{ return {m_lhs, rhs}; }
+
+	template<typename R>
+	constexpr auto operator<=(const R& rhs) const -> BinaryExpression<L, R, std::less_equal<>>{ return {m_lhs, rhs}; }
+
+	template<typename R>
+	constexpr auto operator>(const R& rhs) const -> BinaryExpression<L, R, std::greater<>>{ return {m_lhs, rhs}; }
+
+	template<typename R>
+	constexpr auto operator>=(const R& rhs) const -> BinaryExpression<L, R, std::greater_equal<>>{ return {m_lhs, rhs}; }
+
+	constexpr void check(std::source_location location) const
+	{
+		if(!static_cast<bool>(m_lhs)) [[unlikely]]
+			fail(m_lhs, location);
+	}
+
+private:
+	const L& m_lhs;
+
+	[[noreturn]] TEST_COLD static void fail(const L& lhs, std::source_location location)
+	{
+		test::fail("Check failed - " + toString(lhs), location);
 	}
+};
+
+// Captures the left-hand side of a comparison passed directly to check(), e.g. check(that(a) == b).
+// The operands are referenced and only formatted if the check fails.
+template<typename L>
+constexpr auto that(const L& lhs) -> ExpressionLhs<L>
+{
+	return ExpressionLhs<L>(lhs);
+}
+
+template<typename L, typename R, typename Op>
+constexpr void check(const BinaryExpression<L, R, Op>& expression, std::source_location location = std::source_location::current())
+{
+	expression.check(location);
+}
+
+template<typename L>
+constexpr void check(const ExpressionLhs<L>& expression, std::source_location location = std::source_location::current())
+{
+	expression.check(location);
 }
 
+#if TEST_EXCEPTIONS
 template<typename Exception, typename F>
 void expectException(F f, std::source_location location = std::source_location::current())
 {
@@ -184,230 +515,3655 @@ void expectException(F f, std::source_location location = std::source_location::
 		fail("Expected a different exception type", location);
 	}
 }
+#endif
 
-class TestResults{
-public:
-	TestResults() = default;
+// Polls until the predicate accepts the observed value, backing off exponentially between attempts
+template<typename Observe, typename Predicate, typename Rep, typename Period>
+requires std::invocable<Observe&> && std::predicate<Predicate&, const std::invoke_result_t<Observe&>&>
+void eventually(Observe observe, Predicate predicate, std::chrono::duration<Rep, Period> timeout, std::source_location location = std::source_location::current())
+{
+	constexpr auto maxDelay = std::chrono::microseconds(10000);
 
-	void add(std::string_view testName, bool passed)
+	// Floating point durations are rounded up once so the deadline arithmetic stays in the clock's integral duration
+	const auto limit    = std::chrono::ceil<std::chrono::steady_clock::duration>(timeout);
+	const auto deadline = std::chrono::steady_clock::now() + limit;
+	auto       delay    = std::chrono::microseconds(1);
+
+	while(true)
 	{
-		if(passed)
-			++m_numPassed;
-		else
-			m_failedTestNames.push_back(testName);
-	}
+		const auto value = observe();
 
-	auto numPassed() const -> int{ return m_numPassed; }
-	auto numFailed() const -> int{ return static_cast<int>(m_failedTestNames.size()); }
-	auto totalTests() const -> int{ return m_numPassed + numFailed(); }
-	auto failedTestNames() const -> std::span<const std::string_view>{ return m_failedTestNames; }
+		if(predicate(value))
+			return;
 
-private:
-	int                           m_numPassed = 0;
-	std::vector<std::string_view> m_failedTestNames;
-};
+		const auto now = std::chrono::steady_clock::now();
 
-class ResultLogger{
-public:
-	void logRunningTest(std::string_view testName, std::string_view testCaseName)
-	{
-		if(m_currentTestName != testName)
+		if(now >= deadline)
 		{
-			m_currentTestName = testName;
-			std::cout << "################################ " << testName << " ################################\n";
+			fail(std::format("Condition not met within {}ms - last observed value: {}",
+			                 std::chrono::duration_cast<std::chrono::milliseconds>(limit).count(),
+			                 toString(value)),
+			     location);
 		}
 
-		std::cout << "Executing " << testName << "::" << testCaseName << std::endl;
-	}
-
-	void logFailure(std::string_view testName, std::string_view testCaseName, const TestFailure& failure)
-	{
-			std::cerr <<
-				std::format("FAIL: {}::{} - {}:{}:{} - {}",
-				            testName,
-				            testCaseName,
-				            failure.location().file_name(),
-				            failure.location().line(),
-				            failure.location().column(),
-				            failure.message()) << std::endl;
-	}
-
-	void logError(std::string_view testName, std::string_view testCaseName, std::string_view message)
-	{
-			std::cerr << "ERROR: " << testName << "::" << testCaseName << " - " << message << std::endl;
-	}
-
-	void logSummary(const TestResults& results)
-	{
-		std::cout << "\nResults: " << results.numPassed() << " passed, " << results.numFailed() << " failed (" << results.totalTests() << " total)" << std::endl;
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(delay, deadline - now));
+		delay = std::min(delay * 2, maxDelay);
 	}
+}
 
-private:
-	std::string m_currentTestName;
-};
+template<typename Predicate, typename Rep, typename Period>
+requires std::predicate<Predicate&>
+void eventually(Predicate predicate, std::chrono::duration<Rep, Period> timeout, std::source_location location = std::source_location::current())
+{
+	eventually(predicate, [](bool value){ return value; }, timeout, location);
+}
 
-class TestExecutor{
+// Deterministic clock for time dependent code. Time only moves when advance() is called or, with automatic
+// advancing, as soon as all participating threads are sleeping on the clock.
+class VirtualClock{
 public:
-	TestExecutor() = default;
+	using duration   = std::chrono::nanoseconds;
+	using rep        = duration::rep;
+	using period     = duration::period;
+	using time_point = std::chrono::time_point<VirtualClock, duration>;
+	using TimerId    = std::uint64_t;
 
-	void execute(std::string_view testName, std::string_view testCaseName, std::function<void()> func, ResultLogger& logger)
-	{
-		logger.logRunningTest(testName, testCaseName);
-		auto passed = false;
+	static constexpr bool is_steady = true;
 
-		try
-		{
-			func();
-			passed = true;
-		}
-		catch(const TestFailure& e)
-		{
-			logger.logFailure(testName, testCaseName, e);
-		}
-		catch(const std::exception& e)
+	class Participation{
+	public:
+		explicit Participation(VirtualClock& clock)
+			: m_clock{&clock}
 		{
-			logger.logError(testName, testCaseName, std::string("Unhandled std::exception: ") + e.what());
+			const auto lock = std::lock_guard(m_clock->m_mutex);
+			++m_clock->m_numThreads;
 		}
-		catch(...)
+
+		Participation(const Participation&) = delete;
+		Participation& operator=(const Participation&) = delete;
+
+		~Participation()
 		{
-			logger.logError(testName, testCaseName, "Unhandled unknown exception");
+			const auto lock = std::lock_guard(m_clock->m_mutex);
+			--m_clock->m_numThreads;
+			m_clock->m_sleepersChanged.notify_all();
 		}
 
-		m_results.add(testName, passed);
-	}
+	private:
+		VirtualClock* m_clock;
+	};
 
-	auto results() -> const TestResults&{ return m_results; }
+	explicit VirtualClock(bool autoAdvance = false, time_point start = {})
+		: m_now{start}
+		, m_autoAdvance{autoAdvance}
+	{
+	}
 
-private:
-	TestResults m_results;
-};
+	VirtualClock(const VirtualClock&) = delete;
+	VirtualClock& operator=(const VirtualClock&) = delete;
 
-class TestSuiteInterface{
-public:
-	virtual ~TestSuiteInterface() = default;
-	virtual void executeAll(TestExecutor& executor, ResultLogger& logger) const = 0;
-	virtual void executeTestCase(TestExecutor& executor, std::string_view name, ResultLogger& logger) const = 0;
-};
-using TestSuitePtr = std::unique_ptr<TestSuiteInterface>;
+	auto now() const -> time_point
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		return m_now;
+	}
 
-template<typename ...Args>
-class TestSuite : public TestSuiteInterface{
-public:
-	using TestFunc  = std::function<void(Args...)>;
-	using TupleType = std::tuple<std::decay_t<Args>...>;
+	void advance(duration d)
+	{
+		auto lock = std::unique_lock(m_mutex);
+		advanceTo(m_now + d, lock);
+	}
 
-	struct TestCase{
-		std::string name;
-		TupleType   args;
-	};
+	void advanceTo(time_point t)
+	{
+		auto lock = std::unique_lock(m_mutex);
+		advanceTo(t, lock);
+	}
 
-	TestSuite(std::string testName, TestFunc testFunc)
-		: m_testName{std::move(testName)}
-		, m_testFunc{std::forward<TestFunc>(testFunc)}
+	// Timer callbacks run on the thread that advances the clock
+	auto schedule(time_point t, std::function<void()> callback) -> TimerId
 	{
+		const auto lock = std::lock_guard(m_mutex);
+		const auto id   = m_nextTimerId++;
+		m_timers.emplace(std::pair(t, id), std::move(callback));
+		m_sleepersChanged.notify_all();
+		return id;
 	}
 
-	TestSuite(const TestSuite&) = delete;
-	TestSuite& operator=(const TestSuite&) = delete;
+	auto scheduleAfter(duration d, std::function<void()> callback) -> TimerId
+	{
+		return schedule(now() + d, std::move(callback));
+	}
 
-	void addTestCase(std::string name, Args&&... args)
+	auto cancel(TimerId id) -> bool
 	{
-		m_testCases.push_back({std::move(name), TupleType(std::forward<Args>(args)...)});
+		const auto lock = std::lock_guard(m_mutex);
+		return std::erase_if(m_timers, [id](const auto& timer){ return timer.first.second == id; }) > 0;
 	}
 
-	void addTestCases(std::initializer_list<TestCase> testCases)
+	void sleepFor(duration d)
 	{
-		m_testCases.reserve(m_testCases.size() + testCases.size());
+		auto lock = std::unique_lock(m_mutex);
+		sleepUntil(m_now + d, lock);
+	}
 
-		for(auto& t : testCases)
-			m_testCases.push_back(std::move(t));
+	void sleepUntil(time_point t)
+	{
+		auto lock = std::unique_lock(m_mutex);
+		sleepUntil(t, lock);
 	}
 
-	auto operator()(std::initializer_list<TestCase> testCases) -> TestSuite&
+	// With multiple threads, every thread that sleeps on the clock has to participate for automatic advancing
+	// to know when all of them are idle. A single thread does not need to register.
+	[[nodiscard]] auto participate() -> Participation
 	{
-		addTestCases(testCases);
-		return *this;
+		return Participation(*this);
 	}
 
-	void executeAll(TestExecutor& executor, ResultLogger& logger) const override
+private:
+	mutable std::mutex                                              m_mutex;
+	std::condition_variable                                         m_sleepersChanged;
+	time_point                                                      m_now;
+	bool                                                            m_autoAdvance;
+	bool                                                            m_advancing   = false;
+	int                                                             m_numThreads  = 0;
+	TimerId                                                         m_nextTimerId = 0;
+	std::multiset<time_point>                                       m_deadlines;
+	std::map<std::pair<time_point, TimerId>, std::function<void()>> m_timers;
+
+	void advanceTo(time_point t, std::unique_lock<std::mutex>& lock)
 	{
-		if(m_testCases.empty())
-			throw std::logic_error("Test suite '" + m_testName + "' does not have any test cases");
+		m_advancing = true;
 
-		for(const auto& testCase : m_testCases)
+		while(!m_timers.empty() && m_timers.begin()->first.first <= t)
 		{
-			executor.execute(m_testName, testCase.name,
-				[this, &testCase]()
-				{
-					std::apply(m_testFunc, testCase.args);
-				},
-				logger);
+			auto node = m_timers.extract(m_timers.begin());
+			m_now = std::max(m_now, node.key().first);
+
+			lock.unlock();
+			node.mapped()();
+			lock.lock();
 		}
+
+		m_now       = std::max(m_now, t);
+		m_advancing = false;
+		m_sleepersChanged.notify_all();
 	}
 
-	void executeTestCase(TestExecutor& executor, std::string_view name, ResultLogger& logger) const override
+	void sleepUntil(time_point t, std::unique_lock<std::mutex>& lock)
 	{
-		const auto it = std::ranges::find_if(m_testCases, [name=name](const TestCase& t){ return t.name == name; });
+		const auto deadline = m_deadlines.insert(t);
 
-		if(it == m_testCases.end())
-			throw std::logic_error("Test case '" + std::string(name) + "' does not exist in test suite '" + m_testName + "'");
+		while(m_now < t)
+		{
+			// Deadlines that were reached belong to threads that are waking up and not idle yet
+			const auto pending = m_deadlines.upper_bound(m_now);
+
+			if(m_autoAdvance && !m_advancing && std::distance(pending, m_deadlines.end()) >= m_numThreads)
+			{
+				auto next = *pending;
 
-		executor.execute(m_testName, it->name,
-			[this, &testCase=*it]()
+				if(!m_timers.empty())
+					next = std::min(next, m_timers.begin()->first.first);
+
+				advanceTo(next, lock);
+			}
+			else
 			{
-				std::apply(m_testFunc, testCase.args);
-			},
-			logger);
+				m_sleepersChanged.wait(lock);
+			}
+		}
+
+		m_deadlines.erase(deadline);
 	}
+};
+
+// Seed for randomised tests. It is recorded with failures and restored when replaying them.
+class RandomSeed{
+public:
+	static auto get() -> std::uint64_t{ return value(); }
+	static void set(std::uint64_t seed){ value() = seed; }
 
 private:
-	std::string           m_testName;
-	TestFunc              m_testFunc;
-	std::vector<TestCase> m_testCases;
+	static auto value() -> std::atomic<std::uint64_t>&
+	{
+		static auto seed = std::atomic<std::uint64_t>((std::uint64_t(std::random_device()()) << 32) | std::random_device()());
+		return seed;
+	}
 };
 
-class TestApp{
-public:
-	template<typename F>
-	[[nodiscard]] auto& addTest(std::string name, F&& testFunc)
+inline auto seed() -> std::uint64_t
+{
+	return RandomSeed::get();
+}
+
+// Binary encoding of test arguments for recording and replaying failures. Specialize with static
+// write(std::string&, const T&) and read(std::string_view&) -> T functions to support other types.
+template<typename T>
+struct Serializer;
+
+template<typename T>
+requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+struct Serializer<T>{
+	static void write(std::string& out, const T& value)
 	{
-		auto* testSuite = new TestSuite(std::move(name), std::function(std::forward<F>(testFunc)));
-		auto  ptr       = TestSuitePtr(testSuite);
-		m_tests.push_back(std::move(ptr));
-		return *testSuite;
+		out.append(reinterpret_cast<const char*>(&value), sizeof(value));
 	}
 
-	auto main(int argc = 0, const char* const* const argv = nullptr) -> int
+	static auto read(std::string_view& in) -> T
 	{
-		try
-		{
-			(void)argc;
-			(void)argv;
+		if(in.size() < sizeof(T))
+			throwException(std::runtime_error("Unexpected end of serialized data"));
 
-			auto executor = TestExecutor();
-			auto logger   = ResultLogger();
+		auto value = T();
+		std::memcpy(&value, in.data(), sizeof(value));
+		in.remove_prefix(sizeof(value));
+		return value;
+	}
+};
 
-			for(const auto& test : m_tests)
-				test->executeAll(executor, logger);
+template<>
+struct Serializer<std::string>{
+	static void write(std::string& out, const std::string& value)
+	{
+		Serializer<std::uint64_t>::write(out, value.size());
+		out += value;
+	}
 
-			const auto& results = executor.results();
+	static auto read(std::string_view& in) -> std::string
+	{
+		const auto size = Serializer<std::uint64_t>::read(in);
 
-			logger.logSummary(results);
+		if(in.size() < size)
+			throwException(std::runtime_error("Unexpected end of serialized data"));
 
-			if(results.numFailed() > 0)
-				return EXIT_FAILURE;
-		}
-		catch(const std::exception& e)
+		auto value = std::string(in.substr(0, size));
+		in.remove_prefix(size);
+		return value;
+	}
+};
+
+template<typename T>
+concept Serializable = requires(std::string& out, std::string_view& in, const T& value){
+	Serializer<T>::write(out, value);
+	{ Serializer<T>::read(in) } -> std::same_as<T>;
+};
+
+class TestResults{
+public:
+	TestResults() = default;
+
+	void add(std::string_view testName, bool passed)
+	{
+		if(passed)
+			++m_numPassed;
+		else
+			m_failedTestNames.push_back(testName);
+	}
+
+	void addSkipped()
+	{
+		++m_numSkipped;
+	}
+
+	// Quarantined test cases are reported separately and do not fail the run
+	void addQuarantined(std::string_view testName, bool passed)
+	{
+		if(passed)
+			++m_numQuarantinedPassed;
+		else
+			m_quarantinedFailedTestNames.push_back(testName);
+	}
+
+	auto numPassed() const -> int{ return m_numPassed; }
+	auto numFailed() const -> int{ return static_cast<int>(m_failedTestNames.size()); }
+	auto numSkipped() const -> int{ return m_numSkipped; }
+	auto numQuarantinedPassed() const -> int{ return m_numQuarantinedPassed; }
+	auto numQuarantinedFailed() const -> int{ return static_cast<int>(m_quarantinedFailedTestNames.size()); }
+	auto totalTests() const -> int{ return m_numPassed + numFailed() + m_numSkipped + m_numQuarantinedPassed + numQuarantinedFailed(); }
+	auto failedTestNames() const -> std::span<const std::string_view>{ return m_failedTestNames; }
+	auto quarantinedFailedTestNames() const -> std::span<const std::string_view>{ return m_quarantinedFailedTestNames; }
+
+private:
+	int                           m_numPassed            = 0;
+	int                           m_numSkipped           = 0;
+	int                           m_numQuarantinedPassed = 0;
+	std::vector<std::string_view> m_failedTestNames;
+	std::vector<std::string_view> m_quarantinedFailedTestNames;
+};
+
+// Counters reported by getrusage, the difference of two snapshots is the usage in between
+struct ResourceUsage{
+	std::int64_t minorFaults                = 0;
+	std::int64_t majorFaults                = 0;
+	std::int64_t voluntaryContextSwitches   = 0;
+	std::int64_t involuntaryContextSwitches = 0;
+	std::int64_t blockInputs                = 0;
+	std::int64_t blockOutputs               = 0;
+
+	static auto process() -> ResourceUsage
+	{
+#if TEST_POSIX
+		return get(RUSAGE_SELF);
+#else
+		return {};
+#endif
+	}
+
+	// Falls back to the whole process where per thread usage is not available
+	static auto thread() -> ResourceUsage
+	{
+#ifdef RUSAGE_THREAD
+		return get(RUSAGE_THREAD);
+#else
+		return process();
+#endif
+	}
+
+#if TEST_POSIX
+	static auto from(const rusage& usage) -> ResourceUsage
+	{
+		return {usage.ru_minflt, usage.ru_majflt, usage.ru_nvcsw, usage.ru_nivcsw, usage.ru_inblock, usage.ru_oublock};
+	}
+#endif
+
+	auto operator+=(const ResourceUsage& other) -> ResourceUsage&
+	{
+		minorFaults                += other.minorFaults;
+		majorFaults                += other.majorFaults;
+		voluntaryContextSwitches   += other.voluntaryContextSwitches;
+		involuntaryContextSwitches += other.involuntaryContextSwitches;
+		blockInputs                += other.blockInputs;
+		blockOutputs               += other.blockOutputs;
+		return *this;
+	}
+
+	auto operator+(const ResourceUsage& other) const -> ResourceUsage
+	{
+		auto sum = *this;
+		return sum += other;
+	}
+
+	auto operator-(const ResourceUsage& other) const -> ResourceUsage
+	{
+		return {minorFaults - other.minorFaults,
+		        majorFaults - other.majorFaults,
+		        voluntaryContextSwitches - other.voluntaryContextSwitches,
+		        involuntaryContextSwitches - other.involuntaryContextSwitches,
+		        blockInputs - other.blockInputs,
+		        blockOutputs - other.blockOutputs};
+	}
+
+private:
+#if TEST_POSIX
+	static auto get(int who) -> ResourceUsage
+	{
+		auto usage = rusage();
+
+		if(::getrusage(who, &usage) != 0)
+			return {};
+
+		return from(usage);
+	}
+#endif
+};
+
+struct TestCaseResult{
+	bool                     passed   = false;
+	std::chrono::nanoseconds duration = {};
+	ResourceUsage            usage    = {};
+};
+
+// Quoted and escaped JSON string
+inline auto toJson(std::string_view str) -> std::string
+{
+	auto json = std::string("\"");
+
+	for(const char c : str)
+	{
+		if(c == '"' || c == '\\')
+			json += std::string{'\\', c};
+		else if(static_cast<unsigned char>(c) < 0x20)
+			json += std::format("\\u{:04x}", static_cast<int>(c));
+		else
+			json += c;
+	}
+
+	return json + '"';
+}
+
+// Keeps the compiler from optimizing away a value a benchmark computes but does not otherwise use
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static_cast<void>(*static_cast<const volatile char*>(static_cast<const volatile void*>(&value)));
+#endif
+}
+
+// Additionally makes the compiler assume the value was modified, so it cannot be treated as a constant. Only values
+// that fit into a register may be kept in one, everything else has to be in memory.
+template<typename T>
+inline void doNotOptimize(T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	if constexpr(std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*))
+		asm volatile("" : "+m,r"(value) : : "memory");
+	else
+		asm volatile("" : "+m"(value) : : "memory");
+#else
+	static_cast<void>(*static_cast<volatile char*>(static_cast<volatile void*>(&value)));
+#endif
+}
+
+struct BenchmarkResult{
+	std::string         name;
+	std::uint64_t       numIterations = 0;     // Per sample
+	std::vector<double> samples       = {};    // Nanoseconds per iteration in ascending order
+	bool                coldStart     = false; // Every sample is a first call in a fresh process, see measureColdStart
+	ResourceUsage       usage         = {};    // Summed over all samples of a cold start benchmark
+
+	auto median() const -> double
+	{
+		const auto n = samples.size();
+		return n == 0 ? 0.0 : (samples[(n - 1) / 2] + samples[n / 2]) / 2.0;
+	}
+
+	auto min() const -> double{ return samples.empty() ? 0.0 : samples.front(); }
+	auto max() const -> double{ return samples.empty() ? 0.0 : samples.back(); }
+};
+
+// Calls func in samples of equal iteration counts, calibrated so that every sample takes at least minSampleTime to
+// keep clock resolution and call overhead out of the results. The calibration runs double as warmup, except for the
+// very first call which may include one time initialization and is left out.
+template<std::invocable F>
+auto measure(std::string name, F&& func, int numSamples = 15, std::chrono::nanoseconds minSampleTime = std::chrono::milliseconds(10)) -> BenchmarkResult
+{
+	const auto runSample = [&](std::uint64_t numIterations)
+	{
+		const auto startTime = std::chrono::steady_clock::now();
+
+		for(auto i = std::uint64_t(0); i < numIterations; ++i)
+			func();
+
+		return std::chrono::nanoseconds(std::chrono::steady_clock::now() - startTime);
+	};
+
+	auto result = BenchmarkResult{.name = std::move(name), .numIterations = 1};
+
+	runSample(1);
+
+	for(auto duration = runSample(1); duration < minSampleTime; duration = runSample(result.numIterations))
+	{
+		const auto factor = duration.count() > 0 ? std::min(1.2 * minSampleTime.count() / duration.count(), 10.0) : 10.0;
+		result.numIterations = std::max(result.numIterations + 1, static_cast<std::uint64_t>(result.numIterations * factor));
+	}
+
+	result.samples.reserve(static_cast<std::size_t>(numSamples));
+
+	for(int i = 0; i < numSamples; ++i)
+		result.samples.push_back(static_cast<double>(runSample(result.numIterations).count()) / static_cast<double>(result.numIterations));
+
+	std::ranges::sort(result.samples);
+
+	return result;
+}
+
+// Calls func once in a fresh child process per repetition, so every sample is a first call that pays for lazy
+// initialization and page faults. Children are forked from the fully registered but otherwise unused process.
+inline auto measureColdStart(std::string name, const std::function<void()>& func, int numRepetitions) -> BenchmarkResult
+{
+	auto result = BenchmarkResult{.name = std::move(name), .numIterations = 1, .coldStart = true};
+
+#if TEST_POSIX
+	struct Sample{
+		std::int64_t  durationNs = 0;
+		ResourceUsage usage;
+	};
+
+	for(int i = 0; i < numRepetitions; ++i)
+	{
+		int fds[2];
+
+		if(::pipe(fds) != 0)
+			throwException(std::runtime_error("Failed to create pipe for cold start benchmark '" + result.name + "'"));
+
+		std::cout.flush();
+		std::cerr.flush();
+
+		const auto pid = ::fork();
+
+		if(pid == 0)
+		{
+			::close(fds[0]);
+
+			const auto usage     = ResourceUsage::process();
+			const auto startTime = std::chrono::steady_clock::now();
+
+#if TEST_EXCEPTIONS
+			// Nothing may escape into the caller's copy of the run, the parent reports the failure
+			try
+			{
+				func();
+			}
+			catch(...)
+			{
+				::_exit(EXIT_FAILURE);
+			}
+#else
+			func();
+#endif
+
+			const auto duration = std::chrono::steady_clock::now() - startTime;
+			const auto sample   = Sample{std::chrono::nanoseconds(duration).count(), ResourceUsage::process() - usage};
+
+			(void)::write(fds[1], &sample, sizeof(sample));
+			::_exit(EXIT_SUCCESS);
+		}
+
+		::close(fds[1]);
+
+		auto sample  = Sample();
+		auto numRead = ::read(fds[0], &sample, sizeof(sample));
+		auto status  = 0;
+
+		::close(fds[0]);
+
+		if(pid < 0 || ::waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS || numRead != sizeof(sample))
+			throwException(std::runtime_error("Cold start benchmark '" + result.name + "' failed in child process"));
+
+		result.samples.push_back(static_cast<double>(sample.durationNs));
+		result.usage += sample.usage;
+	}
+
+	std::ranges::sort(result.samples);
+#else
+	static_cast<void>(func);
+	static_cast<void>(numRepetitions);
+	throwException(std::runtime_error("Cold start benchmarks are not supported on this platform"));
+#endif
+
+	return result;
+}
+
+// Discards everything written to it
+class NullStream : public std::ostream{
+public:
+	NullStream()
+		: std::ostream{&m_buffer}
+	{
+	}
+
+private:
+	class Buffer : public std::streambuf{
+	protected:
+		auto overflow(int c) -> int override{ return traits_type::not_eof(c); }
+	};
+
+	Buffer m_buffer;
+};
+
+// Memory for large benchmark inputs, backed by huge pages if possible so the benchmark measures the code rather than
+// page walks. Explicitly reserved huge pages are tried first, then transparent huge pages. All pages are touched up
+// front to keep page faults out of the measurements.
+class HugePageBuffer{
+public:
+	enum class Backing{
+		HugeTlb,              // Reserved huge pages
+		TransparentHugePages, // Promoted by the kernel where possible, see numHugePageBytes for the actual amount
+		RegularPages,
+	};
+
+	// With numaLocal the memory is bound to the NUMA node of the CPU the calling thread currently runs on
+	explicit HugePageBuffer(std::size_t size, bool numaLocal = false)
+		: m_size{size}
+	{
+		const auto pageSize = hugePageSize();
+
+		m_mappedSize = (std::max(size, std::size_t(1)) + pageSize - 1) / pageSize * pageSize;
+
+#ifdef __linux__
+		if(void* const data = ::mmap(nullptr, m_mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0); data != MAP_FAILED)
+		{
+			m_data    = static_cast<std::byte*>(data);
+			m_backing = Backing::HugeTlb;
+		}
+		else
+		{
+			// Transparent huge pages need the buffer to be aligned to the huge page size
+			void* const mapping = ::mmap(nullptr, m_mappedSize + pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if(mapping == MAP_FAILED)
+				throwException(std::bad_alloc());
+
+			const auto begin   = reinterpret_cast<std::uintptr_t>(mapping);
+			const auto aligned = (begin + pageSize - 1) & ~(pageSize - 1);
+
+			if(aligned > begin)
+				::munmap(mapping, aligned - begin);
+
+			if(const auto tail = begin + pageSize - aligned; tail > 0)
+				::munmap(reinterpret_cast<void*>(aligned + m_mappedSize), tail);
+
+			m_data    = reinterpret_cast<std::byte*>(aligned);
+			m_backing = ::madvise(m_data, m_mappedSize, MADV_HUGEPAGE) == 0 ? Backing::TransparentHugePages : Backing::RegularPages;
+		}
+
+		if(numaLocal)
+			m_numaLocal = bindToCurrentNode(m_data, m_mappedSize);
+
+		const auto regularPageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+		for(std::size_t i = 0; i < m_mappedSize; i += regularPageSize)
+			m_data[i] = std::byte(0);
+#else
+		m_data = static_cast<std::byte*>(::operator new(m_mappedSize, std::align_val_t(pageSize)));
+		std::memset(m_data, 0, m_mappedSize);
+#endif
+	}
+
+	HugePageBuffer(HugePageBuffer&& other) noexcept
+		: m_data{std::exchange(other.m_data, nullptr)}
+		, m_size{std::exchange(other.m_size, 0)}
+		, m_mappedSize{std::exchange(other.m_mappedSize, 0)}
+		, m_backing{other.m_backing}
+		, m_numaLocal{other.m_numaLocal}
+	{
+	}
+
+	HugePageBuffer(const HugePageBuffer&) = delete;
+	HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+
+	~HugePageBuffer()
+	{
+		if(!m_data)
+			return;
+
+#ifdef __linux__
+		::munmap(m_data, m_mappedSize);
+#else
+		::operator delete(m_data, std::align_val_t(hugePageSize()));
+#endif
+	}
+
+	auto data() const -> std::byte*{ return m_data; }
+	auto size() const -> std::size_t{ return m_size; }
+	auto backing() const -> Backing{ return m_backing; }
+	auto isNumaLocal() const -> bool{ return m_numaLocal; }
+
+	template<typename T>
+	auto as() const -> std::span<T>
+	{
+		return {reinterpret_cast<T*>(m_data), m_size / sizeof(T)};
+	}
+
+	// Number of bytes of the buffer the kernel currently backs with huge pages
+	auto numHugePageBytes() const -> std::size_t
+	{
+		if(m_backing == Backing::HugeTlb)
+			return m_mappedSize;
+
+		if(m_backing == Backing::RegularPages)
+			return 0;
+
+		// The mapping may have been merged with neighboring ones, so the count is capped at the size of the buffer
+		auto stream  = std::ifstream("/proc/self/smaps");
+		auto line    = std::string();
+		auto inRange = false;
+
+		while(std::getline(stream, line))
+		{
+			auto begin = std::uintptr_t(0);
+			auto end   = std::uintptr_t(0);
+
+			if(std::sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR " ", &begin, &end) == 2)
+			{
+				const auto data = reinterpret_cast<std::uintptr_t>(m_data);
+				inRange = begin <= data && data < end;
+			}
+			else if(inRange && line.starts_with("AnonHugePages:"))
+			{
+				return std::min(static_cast<std::size_t>(std::stoull(line.substr(line.find(':') + 1))) * 1024, m_mappedSize);
+			}
+		}
+
+		return 0;
+	}
+
+	static auto hugePageSize() -> std::size_t
+	{
+		static const auto size = []()
+		{
+			auto stream = std::ifstream("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+			auto value  = std::size_t(0);
+
+			return stream >> value && value > 0 ? value : std::size_t(2) << 20;
+		}();
+
+		return size;
+	}
+
+private:
+	std::byte*  m_data       = nullptr;
+	std::size_t m_size       = 0;
+	std::size_t m_mappedSize = 0;
+	Backing     m_backing    = Backing::RegularPages;
+	bool        m_numaLocal  = false;
+
+#ifdef __linux__
+	static auto bindToCurrentNode(void* data, std::size_t size) -> bool
+	{
+		constexpr auto bitsPerWord = sizeof(unsigned long) * 8;
+
+		unsigned      cpu          = 0;
+		unsigned      node         = 0;
+		unsigned long nodeMask[16] = {};
+
+		if(::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= std::size(nodeMask) * bitsPerWord)
+			return false;
+
+		nodeMask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+
+		return ::syscall(SYS_mbind, data, size, MPOL_BIND, nodeMask, std::size(nodeMask) * bitsPerWord + 1, 0) == 0;
+	}
+#endif
+};
+
+inline auto toString(HugePageBuffer::Backing backing) -> std::string
+{
+	switch(backing)
+	{
+	case HugePageBuffer::Backing::HugeTlb:
+		return "huge pages";
+	case HugePageBuffer::Backing::TransparentHugePages:
+		return "transparent huge pages";
+	case HugePageBuffer::Backing::RegularPages:
+		break;
+	}
+
+	return "regular pages";
+}
+
+// Characteristics of the machine benchmarks run on, so results from different hosts can be normalized. Probing takes
+// a moment, so the profile is cached in a file per host.
+struct MachineProfile{
+	struct Cache{
+		std::size_t size      = 0;   // Bytes, 0 if the level does not exist
+		double      latencyNs = 0.0; // Dependent load hitting this level
+	};
+
+	std::string          host;
+	unsigned             numCores        = 0;
+	std::array<Cache, 3> caches          = {}; // L1 data, L2 and L3
+	double               memoryBandwidth = 0.0; // Bytes per second reading sequentially on one core
+
+	static auto probe() -> MachineProfile
+	{
+		constexpr auto maxLatencyWorkingSet   = std::size_t(64) << 20;
+		constexpr auto minBandwidthWorkingSet = std::size_t(64) << 20;
+		constexpr auto maxBandwidthWorkingSet = std::size_t(512) << 20;
+
+		auto profile = MachineProfile{.host = hostName(), .numCores = std::max(std::thread::hardware_concurrency(), 1u)};
+
+		profile.caches = cacheSizes();
+
+		// Half of a level fits into it with room to spare while being far larger than the level below
+		for(auto& cache : profile.caches)
+		{
+			if(cache.size > 0)
+				cache.latencyNs = chaseLatency(std::min(cache.size / 2, maxLatencyWorkingSet));
+		}
+
+		profile.memoryBandwidth = readBandwidth(std::clamp(profile.caches[2].size * 4, minBandwidthWorkingSet, maxBandwidthWorkingSet));
+
+		return profile;
+	}
+
+	// Returns the profile from the file if it was probed on this host
+	static auto cached(const std::filesystem::path& file) -> std::optional<MachineProfile>
+	{
+		if(file.empty())
+			return std::nullopt;
+
+		if(auto profile = load(file); profile && profile->host == hostName())
+			return profile;
+
+		return std::nullopt;
+	}
+
+	// Lives in the cache directory of the user since a predictable name in a shared temporary directory could be
+	// planted by someone else. Empty if the user has no home directory.
+	static auto defaultFile() -> std::filesystem::path
+	{
+		const auto fileName = "test-machine-" + hostName();
+
+		if(const auto* const cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome && *cacheHome)
+			return std::filesystem::path(cacheHome) / fileName;
+
+		if(const auto* const home = std::getenv("HOME"); home && *home)
+			return std::filesystem::path(home) / ".cache" / fileName;
+
+		return {};
+	}
+
+	static auto load(const std::filesystem::path& file) -> std::optional<MachineProfile>
+	{
+		auto stream  = std::ifstream(file);
+		auto profile = MachineProfile();
+		auto key     = std::string();
+
+		if(!stream)
+			return std::nullopt;
+
+		while(stream >> key)
+		{
+			if(key == "host")
+				stream >> profile.host;
+			else if(key == "cores")
+				stream >> profile.numCores;
+			else if(key == "bandwidth")
+				stream >> profile.memoryBandwidth;
+			else if(key.size() == 2 && key[0] == 'L' && key[1] >= '1' && key[1] <= '3')
+				stream >> profile.caches[static_cast<std::size_t>(key[1] - '1')].size >> profile.caches[static_cast<std::size_t>(key[1] - '1')].latencyNs;
+			else
+				return std::nullopt;
+		}
+
+		if(profile.host.empty())
+			return std::nullopt;
+
+		return profile;
+	}
+
+	// Written in full precision so a loaded profile compares equal to the probed one. The profile is only a cache,
+	// so failing to write it is returned instead of thrown.
+	[[nodiscard]] auto save(const std::filesystem::path& file) const -> bool
+	{
+		const auto tempFile = std::filesystem::path(file).concat(".tmp");
+		auto       ec       = std::error_code();
+
+		std::filesystem::create_directories(file.parent_path(), ec);
+
+		{
+			auto stream = std::ofstream(tempFile);
+
+			stream << std::format("host {}\ncores {}\nbandwidth {}\n", host, numCores, memoryBandwidth);
+
+			for(std::size_t i = 0; i < caches.size(); ++i)
+				stream << std::format("L{} {} {}\n", i + 1, caches[i].size, caches[i].latencyNs);
+
+			if(!stream)
+			{
+				std::filesystem::remove(tempFile, ec);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(tempFile, file, ec);
+
+		if(ec)
+			std::filesystem::remove(tempFile, ec);
+
+		return !ec;
+	}
+
+	auto toJson() const -> std::string
+	{
+		auto json = std::format(R"({{"host": {}, "cores": {}, "bandwidth_bytes_per_s": {})", test::toJson(host), numCores, memoryBandwidth);
+
+		for(std::size_t i = 0; i < caches.size(); ++i)
+			json += std::format(R"(, "l{}_bytes": {}, "l{}_latency_ns": {})", i + 1, caches[i].size, i + 1, caches[i].latencyNs);
+
+		return json + '}';
+	}
+
+private:
+	static auto hostName() -> std::string
+	{
+#if TEST_POSIX
+		char name[256] = {};
+
+		if(::gethostname(name, sizeof(name) - 1) == 0 && name[0] != '\0')
+			return name;
+#endif
+		return "localhost";
+	}
+
+	// Reads the data and unified caches of the first CPU from sysfs. Common sizes are only guessed without sysfs, a
+	// level sysfs does not list does not exist.
+	static auto cacheSizes() -> std::array<Cache, 3>
+	{
+		auto ec      = std::error_code();
+		auto entries = std::filesystem::directory_iterator("/sys/devices/system/cpu/cpu0/cache", ec);
+
+		if(ec)
+			return {Cache{std::size_t(32) << 10}, Cache{std::size_t(1) << 20}, Cache{std::size_t(8) << 20}};
+
+		auto caches = std::array<Cache, 3>();
+
+		for(const auto& entry : entries)
+		{
+			auto level = 0;
+			auto type  = std::string();
+			auto size  = std::string();
+
+			std::ifstream(entry.path() / "level") >> level;
+			std::ifstream(entry.path() / "type") >> type;
+			std::ifstream(entry.path() / "size") >> size;
+
+			if(level < 1 || level > 3 || type == "Instruction" || size.empty())
+				continue;
+
+			auto numChars = std::size_t(0);
+			auto bytes    = std::stoull(size, &numChars);
+
+			if(numChars < size.size())
+				bytes <<= size[numChars] == 'K' ? 10 : size[numChars] == 'M' ? 20 : size[numChars] == 'G' ? 30 : 0;
+
+			caches[static_cast<std::size_t>(level - 1)].size = static_cast<std::size_t>(bytes);
+		}
+
+		return caches;
+	}
+
+	// Follows a random cycle through the working set so every load depends on the previous one and defeats prefetching
+	static auto chaseLatency(std::size_t workingSet) -> double
+	{
+		constexpr auto numSteps = 1 << 21;
+
+		struct alignas(64) Line{
+			const Line* next = nullptr;
+		};
+
+		const auto numLines = std::max<std::size_t>(workingSet / sizeof(Line), 2);
+
+		auto lines  = std::vector<Line>(numLines);
+		auto order  = std::vector<std::size_t>(numLines);
+		auto random = std::mt19937_64(numLines);
+
+		std::iota(order.begin(), order.end(), std::size_t(0));
+		std::shuffle(order.begin(), order.end(), random);
+
+		for(std::size_t i = 0; i < numLines; ++i)
+			lines[order[i]].next = &lines[order[(i + 1) % numLines]];
+
+		const auto* line = &lines[order[0]];
+
+		for(std::size_t i = 0; i < numLines; ++i)
+			line = line->next;
+
+		const auto startTime = std::chrono::steady_clock::now();
+
+		for(int i = 0; i < numSteps; ++i)
+			line = line->next;
+
+		const auto duration = std::chrono::nanoseconds(std::chrono::steady_clock::now() - startTime);
+
+		doNotOptimize(line);
+
+		return static_cast<double>(duration.count()) / numSteps;
+	}
+
+	// Best of a few passes to skip interference from the rest of the system
+	static auto readBandwidth(std::size_t workingSet) -> double
+	{
+		constexpr auto numPasses = 5;
+
+		const auto data = std::vector<std::uint64_t>(workingSet / sizeof(std::uint64_t), 1);
+		auto       best = std::chrono::nanoseconds::max();
+
+		for(int i = 0; i < numPasses; ++i)
+		{
+			const auto startTime = std::chrono::steady_clock::now();
+			const auto sum       = std::accumulate(data.begin(), data.end(), std::uint64_t(0));
+
+			doNotOptimize(sum);
+			best = std::min(best, std::chrono::nanoseconds(std::chrono::steady_clock::now() - startTime));
+		}
+
+		return static_cast<double>(data.size() * sizeof(std::uint64_t)) / (static_cast<double>(std::max<std::int64_t>(best.count(), 1)) / 1e9);
+	}
+};
+
+class ResultLogger{
+public:
+	explicit ResultLogger(std::ostream& out = std::cout, std::ostream& err = std::cerr)
+		: m_out{out}
+		, m_err{err}
+	{
+	}
+
+	void logRunningTest(std::string_view testName, std::string_view testCaseName)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+
+		if(m_currentTestName != testName)
+		{
+			m_currentTestName = testName;
+			m_out << "################################ " << testName << " ################################\n";
+		}
+
+		m_out << "Executing " << testName << "::" << testCaseName << std::endl;
+	}
+
+	void logFailure(std::string_view testName, std::string_view testCaseName, const TestFailure& failure)
+	{
+		logFailure(testName,
+		           testCaseName,
+		           std::format("{}:{}:{}", failure.location().file_name(), failure.location().line(), failure.location().column()),
+		           failure.message());
+	}
+
+	void logFailure(std::string_view testName, std::string_view testCaseName, std::string_view location, std::string_view message)
+	{
+			const auto lock = std::lock_guard(m_mutex);
+			m_err << std::format("FAIL: {}::{} - {} - {}", testName, testCaseName, location, message) << std::endl;
+	}
+
+	void logError(std::string_view testName, std::string_view testCaseName, std::string_view message)
+	{
+			const auto lock = std::lock_guard(m_mutex);
+			m_err << "ERROR: " << testName << "::" << testCaseName << " - " << message << std::endl;
+	}
+
+	void logWarning(std::string_view message)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_err << "WARNING: " << message << std::endl;
+	}
+
+	void logFlaky(std::string_view testName, std::string_view testCaseName, double passRate)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_out << "FLAKY: " << testName << "::" << testCaseName << " - pass rate " << static_cast<int>(passRate * 100.0) << '%' << std::endl;
+	}
+
+	void logRetry(std::string_view testName, std::string_view testCaseName, int attempt)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_out << "RETRY: " << testName << "::" << testCaseName << " - attempt " << attempt << " of flaky test case" << std::endl;
+	}
+
+	void logPolluter(std::string_view polluter, std::string_view victim)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_err << "POLLUTER: " << polluter << " makes " << victim << " fail" << std::endl;
+	}
+
+	void logSkipped(std::string_view testName, std::string_view testCaseName, std::string_view reason)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_out << "SKIPPED: " << testName << "::" << testCaseName << " - " << reason << std::endl;
+	}
+
+	void logResourceUsage(std::string_view testName, std::string_view testCaseName, const ResourceUsage& usage)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_out << std::format("USAGE: {}::{} - page faults {} minor, {} major - context switches {} voluntary, {} involuntary - block I/O {} in, {} out",
+		                     testName, testCaseName, usage.minorFaults, usage.majorFaults, usage.voluntaryContextSwitches,
+		                     usage.involuntaryContextSwitches, usage.blockInputs, usage.blockOutputs) << std::endl;
+	}
+
+	void logNumaPlacement(std::size_t numNodes)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_out << "NUMA: Workers pinned across " << numNodes << " nodes" << std::endl;
+	}
+
+	void logImpactSelection(std::size_t numSelected, std::size_t numTestCases)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_out << "IMPACT: Running " << numSelected << " of " << numTestCases << " test cases affected by the changes" << std::endl;
+	}
+
+	void logReplayFile(std::string_view testName, std::string_view testCaseName, const std::filesystem::path& file)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		m_err << "REPLAY: " << testName << "::" << testCaseName << " - " << file.string() << std::endl;
+	}
+
+	void logMachineProfile(const MachineProfile& profile)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+
+		m_out << "MACHINE: " << profile.host << " - " << profile.numCores << " cores";
+
+		for(std::size_t i = 0; i < profile.caches.size(); ++i)
+		{
+			if(profile.caches[i].size > 0)
+				m_out << std::format(", L{} {} KiB {}", i + 1, profile.caches[i].size >> 10, formatNanoseconds(profile.caches[i].latencyNs));
+		}
+
+		m_out << std::format(", memory bandwidth {:.1f} GB/s", profile.memoryBandwidth / 1e9) << std::endl;
+	}
+
+	void logBenchmark(const BenchmarkResult& result)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+
+		if(result.coldStart)
+		{
+			const auto numSamples = static_cast<double>(std::max<std::size_t>(result.samples.size(), 1));
+
+			m_out << std::format("COLD START: {} - median {}, min {}, max {} ({} processes), {:.1f} minor and {:.1f} major page faults per first call",
+			                     result.name, formatNanoseconds(result.median()), formatNanoseconds(result.min()), formatNanoseconds(result.max()),
+			                     result.samples.size(), static_cast<double>(result.usage.minorFaults) / numSamples,
+			                     static_cast<double>(result.usage.majorFaults) / numSamples) << std::endl;
+			return;
+		}
+
+		m_out << std::format("BENCHMARK: {} - median {}, min {}, max {} ({} samples of {} iterations)",
+		                     result.name, formatNanoseconds(result.median()), formatNanoseconds(result.min()), formatNanoseconds(result.max()),
+		                     result.samples.size(), result.numIterations) << std::endl;
+	}
+
+	void logSummary(const TestResults& results)
+	{
+		m_out << "\nResults: " << results.numPassed() << " passed, " << results.numFailed() << " failed";
+
+		if(results.numSkipped() > 0)
+			m_out << ", " << results.numSkipped() << " skipped";
+
+		m_out << " (" << results.totalTests() << " total)" << std::endl;
+
+		if(results.numQuarantinedPassed() + results.numQuarantinedFailed() > 0)
+			m_out << "Quarantined: " << results.numQuarantinedPassed() << " passed, " << results.numQuarantinedFailed() << " failed (not gating)" << std::endl;
+	}
+
+private:
+	std::ostream& m_out;
+	std::ostream& m_err;
+	std::mutex    m_mutex;
+	std::string   m_currentTestName;
+
+	static auto formatNanoseconds(double ns) -> std::string
+	{
+		if(ns >= 1e9)
+			return std::format("{:.3f} s", ns / 1e9);
+		if(ns >= 1e6)
+			return std::format("{:.3f} ms", ns / 1e6);
+		if(ns >= 1e3)
+			return std::format("{:.3f} us", ns / 1e3);
+
+		return std::format("{:.3f} ns", ns);
+	}
+};
+
+class ScratchDirectories{
+public:
+	ScratchDirectories()
+		: m_cleaner{[this](std::stop_token stopToken){ clean(stopToken); }}
+	{
+	}
+
+	ScratchDirectories(const ScratchDirectories&) = delete;
+	ScratchDirectories& operator=(const ScratchDirectories&) = delete;
+
+	~ScratchDirectories()
+	{
+		m_cleaner.request_stop();
+		m_cleaner.join();
+
+		removeAll();
+	}
+
+	struct Directory{
+		std::filesystem::path path;
+		bool                  created = false;
+	};
+
+	// Hands the scratch directory of the test case that just finished on this thread over to the cleanup thread
+	void release()
+	{
+		auto& dir = current();
+
+		if(!dir)
+			return;
+
+		{
+			const auto lock = std::lock_guard(m_mutex);
+			m_pendingRemoval.push_back(std::move(dir->path));
+		}
+
+		dir.reset();
+		m_pendingRemovalAdded.notify_one();
+	}
+
+	// Decides on the directory of the next test case on this thread without creating it. Called before forking a
+	// child process for a test case, so the parent knows which directory to release once the child is gone.
+	static void reserve()
+	{
+		if(auto& dir = current(); !dir)
+			dir = Directory{next()};
+	}
+
+	// Removes the directories of all test cases at once, for processes that only run test cases in child processes
+	static void removeAll()
+	{
+		auto ec = std::error_code();
+		std::filesystem::remove_all(root(), ec);
+	}
+
+	static auto current() -> std::optional<Directory>&
+	{
+		thread_local auto dir = std::optional<Directory>();
+		return dir;
+	}
+
+	static auto next() -> std::filesystem::path
+	{
+		static auto counter = std::atomic<unsigned>();
+		return root() / std::to_string(counter++);
+	}
+
+	// Prefers tmpfs so test I/O does not hit the disk
+	static auto root() -> const std::filesystem::path&
+	{
+		static const auto dir = []()
+		{
+			auto ec   = std::error_code();
+			auto base = std::filesystem::path("/dev/shm");
+
+			if(!std::filesystem::is_directory(base, ec))
+				base = std::filesystem::temp_directory_path();
+
+			return base / std::format("test-{:x}", std::random_device()());
+		}();
+
+		return dir;
+	}
+
+private:
+	std::mutex                         m_mutex;
+	std::condition_variable_any        m_pendingRemovalAdded;
+	std::vector<std::filesystem::path> m_pendingRemoval;
+	std::jthread                       m_cleaner;
+
+	void clean(std::stop_token stopToken)
+	{
+		auto lock = std::unique_lock(m_mutex);
+
+		while(true)
+		{
+			m_pendingRemovalAdded.wait(lock, stopToken, [this](){ return !m_pendingRemoval.empty(); });
+
+			if(m_pendingRemoval.empty())
+				return;
+
+			auto dirs = std::exchange(m_pendingRemoval, {});
+			lock.unlock();
+
+			for(const auto& dir : dirs)
+			{
+				auto ec = std::error_code();
+				std::filesystem::remove_all(dir, ec);
+			}
+
+			lock.lock();
+		}
+	}
+};
+
+// Returns a directory that is unique to the currently running test case and removed once it finishes
+inline auto scratchDir() -> const std::filesystem::path&
+{
+	auto& dir = ScratchDirectories::current();
+
+	if(!dir)
+		dir = ScratchDirectories::Directory{ScratchDirectories::next()};
+
+	if(!dir->created)
+	{
+		std::filesystem::create_directories(dir->path);
+		dir->created = true;
+	}
+
+	return dir->path;
+}
+
+// Monotonic memory of the test case running on the current thread. Releasing it at the end of the test case only
+// frees the blocks that did not fit into the initial buffer, which is reused by the next test case on this thread.
+class TestArena{
+public:
+	static constexpr std::size_t initialSize = 1 << 20;
+
+	// Creates the arena of the current thread on first use
+	static auto current() -> TestArena&
+	{
+		auto& arena = instance();
+
+		if(!arena)
+			arena.reset(new TestArena());
+
+		return *arena;
+	}
+
+	// Does nothing on threads whose test cases never used an arena
+	static void releaseCurrent()
+	{
+		if(const auto& arena = instance())
+			arena->m_resource.release();
+	}
+
+	auto resource() -> std::pmr::memory_resource&{ return m_resource; }
+
+private:
+	std::unique_ptr<std::byte[]>        m_buffer   = std::make_unique_for_overwrite<std::byte[]>(initialSize);
+	std::pmr::monotonic_buffer_resource m_resource = std::pmr::monotonic_buffer_resource(m_buffer.get(), initialSize);
+
+	TestArena() = default;
+
+	static auto instance() -> std::unique_ptr<TestArena>&
+	{
+		thread_local auto arena = std::unique_ptr<TestArena>();
+		return arena;
+	}
+};
+
+// Memory resource that is released in one go when the current test case finishes, nothing allocated from it may outlive the test case
+inline auto arena() -> std::pmr::memory_resource&
+{
+	return TestArena::current().resource();
+}
+
+// Bump allocated heap of a child process running an isolated test case. The global allocation functions only use it
+// if TEST_ISOLATED_HEAP is defined in one translation unit, so every test case starts with the same clean heap and
+// nothing is freed since the process exits right after the test case. Memory allocated before the fork is still
+// freed normally.
+class IsolatedHeap{
+public:
+	static constexpr std::size_t reservedSize = std::size_t(1) << 36; // Address space only, pages are committed on first use
+
+	// Called in the child process before it runs the test case while it is still single threaded
+	static void activate() noexcept
+	{
+#if TEST_POSIX
+		void* const base = ::mmap(nullptr, reservedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+		if(base != MAP_FAILED)
+			instance().m_base = static_cast<std::byte*>(base);
+#endif
+	}
+
+	// Returns nullptr if the heap is inactive or exhausted
+	static auto allocate(std::size_t size, std::size_t alignment) noexcept -> void*
+	{
+		auto& heap = instance();
+
+		if(!heap.m_base)
+			return nullptr;
+
+		auto offset = heap.m_used.load(std::memory_order_relaxed);
+		auto begin  = std::size_t(0);
+
+		do
+		{
+			begin = (offset + alignment - 1) & ~(alignment - 1);
+
+			if(begin + size > reservedSize)
+				return nullptr;
+		}
+		while(!heap.m_used.compare_exchange_weak(offset, begin + size, std::memory_order_relaxed));
+
+		return heap.m_base + begin;
+	}
+
+	static auto contains(const void* ptr) noexcept -> bool
+	{
+		const auto& heap = instance();
+		const auto* p    = static_cast<const std::byte*>(ptr);
+
+		return heap.m_base && p >= heap.m_base && p < heap.m_base + reservedSize;
+	}
+
+private:
+	std::byte*               m_base = nullptr;
+	std::atomic<std::size_t> m_used = 0;
+
+	static auto instance() noexcept -> IsolatedHeap&
+	{
+		static auto heap = IsolatedHeap();
+		return heap;
+	}
+};
+
+class TestExecutor{
+public:
+	TestExecutor() = default;
+
+	// Isolated test cases run in a child process each, which builds without exceptions always do if they can fork
+	explicit TestExecutor(bool isolated)
+		: m_isolated{isolated || !TEST_EXCEPTIONS}
+	{
+#if !TEST_POSIX
+		if(isolated)
+			throwException(std::logic_error("Isolating test cases requires fork()"));
+#endif
+	}
+
+	auto execute(std::string_view testName, std::string_view testCaseName, std::function<void()> func, ResultLogger& logger) -> TestCaseResult
+	{
+		const auto result = run(testName, testCaseName, func, logger);
+		addResult(testName, result.passed);
+		return result;
+	}
+
+	// Runs the test case without adding it to the results, see addResult
+	auto run(std::string_view testName, std::string_view testCaseName, const std::function<void()>& func, ResultLogger& logger) -> TestCaseResult
+	{
+		logger.logRunningTest(testName, testCaseName);
+		TEST_PROBE(case_start, testName.data(), testName.size(), testCaseName.data(), testCaseName.size());
+
+		auto       childUsage = ResourceUsage();
+		const auto usage      = ResourceUsage::thread();
+		const auto startTime  = std::chrono::steady_clock::now();
+		const auto passed     = invoke(testName, testCaseName, func, logger, childUsage);
+		const auto duration   = std::chrono::steady_clock::now() - startTime;
+
+		TEST_PROBE(case_end, testName.data(), testName.size(), testCaseName.data(), testCaseName.size(), passed, std::chrono::nanoseconds(duration).count());
+
+		m_scratchDirectories.release();
+		TestArena::releaseCurrent();
+
+		return {passed, duration, ResourceUsage::thread() - usage + childUsage};
+	}
+
+	void addResult(std::string_view testName, bool passed, bool quarantined = false)
+	{
+		const auto lock = std::lock_guard(m_mutex);
+
+		if(quarantined)
+			m_results.addQuarantined(testName, passed);
+		else
+			m_results.add(testName, passed);
+	}
+
+	void skip(std::string_view testName, std::string_view testCaseName, std::string_view reason, ResultLogger& logger)
+	{
+		logger.logSkipped(testName, testCaseName, reason);
+
+		const auto lock = std::lock_guard(m_mutex);
+		m_results.addSkipped();
+	}
+
+	auto results() -> const TestResults&{ return m_results; }
+	auto isolated() const -> bool{ return m_isolated; }
+
+private:
+	std::mutex         m_mutex;
+	TestResults        m_results;
+	ScratchDirectories m_scratchDirectories;
+	bool               m_isolated = !TEST_EXCEPTIONS;
+
+	auto invoke(std::string_view testName, std::string_view testCaseName, const std::function<void()>& func, ResultLogger& logger, ResourceUsage& childUsage) const -> bool
+	{
+#if TEST_POSIX
+		if(m_isolated)
+			return invokeIsolated(testName, testCaseName, func, logger, childUsage);
+#endif
+		return invokeInProcess(testName, testCaseName, func, logger);
+	}
+
+#if TEST_EXCEPTIONS
+	static auto invokeInProcess(std::string_view testName, std::string_view testCaseName, const std::function<void()>& func, ResultLogger& logger) -> bool
+	{
+		try
+		{
+			func();
+			return true;
+		}
+		catch(const TestFailure& e)
+		{
+			logger.logFailure(testName, testCaseName, e);
+		}
+		catch(const std::exception& e)
+		{
+			logger.logError(testName, testCaseName, std::string("Unhandled std::exception: ") + e.what());
+		}
+		catch(...)
+		{
+			logger.logError(testName, testCaseName, "Unhandled unknown exception");
+		}
+
+		return false;
+	}
+#else
+	// Without exceptions or processes the first failure aborts the whole run
+	static auto invokeInProcess(std::string_view, std::string_view, const std::function<void()>& func, ResultLogger&) -> bool
+	{
+		func();
+		return true;
+	}
+#endif
+
+#if TEST_POSIX
+	// Runs the test case in a child process which exits on the first failure and reports it through a pipe. The
+	// resource usage of the child is added to childUsage.
+	static auto invokeIsolated(std::string_view testName, std::string_view testCaseName, const std::function<void()>& func, ResultLogger& logger, ResourceUsage& childUsage) -> bool
+	{
+		int fds[2];
+
+		if(::pipe(fds) != 0)
+		{
+			logger.logError(testName, testCaseName, "Failed to create pipe for isolated test case");
+			return false;
+		}
+
+		std::cout.flush();
+		std::cerr.flush();
+		ScratchDirectories::reserve();
+
+		const auto pid = ::fork();
+
+		if(pid == 0)
+		{
+			::close(fds[0]);
+			IsolatedHeap::activate();
+#if TEST_EXCEPTIONS
+			// Reports like fail() does without exceptions, an error has no location part
+			const auto report = [fd = fds[1]](const std::string& message)
+			{
+				(void)::write(fd, message.data(), message.size());
+				std::cout.flush();
+				::_exit(EXIT_FAILURE);
+			};
+
+			try
+			{
+				func();
+			}
+			catch(const TestFailure& e)
+			{
+				report(std::format("{}:{}:{}", e.location().file_name(), e.location().line(), e.location().column()) + '\0' + e.message());
+			}
+			catch(const std::exception& e)
+			{
+				report(std::string("Unhandled std::exception: ") + e.what());
+			}
+			catch(...)
+			{
+				report("Unhandled unknown exception");
+			}
+#else
+			failureChannel() = fds[1];
+			func();
+#endif
+			std::cout.flush();
+			::_exit(EXIT_SUCCESS);
+		}
+
+		::close(fds[1]);
+
+		auto report = std::string();
+		char buffer[4096];
+
+		for(auto n = ::read(fds[0], buffer, sizeof(buffer)); n > 0; n = ::read(fds[0], buffer, sizeof(buffer)))
+			report.append(buffer, static_cast<std::size_t>(n));
+
+		::close(fds[0]);
+
+		auto status = 0;
+		auto usage  = rusage();
+
+		if(pid < 0 || ::wait4(pid, &status, 0, &usage) != pid)
+		{
+			logger.logError(testName, testCaseName, "Failed to run isolated test case");
+			return false;
+		}
+
+		childUsage = ResourceUsage::from(usage);
+
+		if(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)
+			return true;
+
+		if(const auto separator = report.find('\0'); separator != std::string::npos)
+			logger.logFailure(testName, testCaseName, std::string_view(report).substr(0, separator), std::string_view(report).substr(separator + 1));
+		else if(!report.empty())
+			logger.logError(testName, testCaseName, report);
+		else if(WIFSIGNALED(status))
+			logger.logError(testName, testCaseName, "Terminated by signal " + std::to_string(WTERMSIG(status)));
+		else
+			logger.logError(testName, testCaseName, "Exited with code " + std::to_string(WEXITSTATUS(status)));
+
+		return false;
+	}
+#endif
+};
+
+enum class ResourceAccess{
+	Shared,
+	Exclusive
+};
+
+struct ResourceLock{
+	std::string    name;
+	ResourceAccess access = ResourceAccess::Exclusive;
+};
+
+inline auto exclusive(std::string resource) -> ResourceLock
+{
+	return {std::move(resource), ResourceAccess::Exclusive};
+}
+
+inline auto shared(std::string resource) -> ResourceLock
+{
+	return {std::move(resource), ResourceAccess::Shared};
+}
+
+// Every test case implicitly holds a shared lock on the unnamed resource so a serial one runs alone
+inline auto serial() -> ResourceLock
+{
+	return exclusive("");
+}
+
+class ResourceTracker{
+public:
+	auto tryAcquire(std::span<const ResourceLock> suiteLocks, std::span<const ResourceLock> testCaseLocks) -> bool
+	{
+		const auto locks = merge(suiteLocks, testCaseLocks);
+
+		const auto available = std::ranges::all_of(locks, [this](const auto& lock)
+		{
+			const auto it = m_holders.find(lock.first);
+			return it == m_holders.end() || (lock.second == ResourceAccess::Shared && it->second > 0);
+		});
+
+		if(!available)
+			return false;
+
+		for(const auto& [name, access] : locks)
+		{
+			if(access == ResourceAccess::Exclusive)
+				m_holders.emplace(name, -1);
+			else
+				++m_holders[name];
+		}
+
+		return true;
+	}
+
+	void release(std::span<const ResourceLock> suiteLocks, std::span<const ResourceLock> testCaseLocks)
+	{
+		for(const auto& [name, access] : merge(suiteLocks, testCaseLocks))
+		{
+			const auto it = m_holders.find(name);
+
+			if(access == ResourceAccess::Exclusive || --it->second == 0)
+				m_holders.erase(it);
+		}
+	}
+
+private:
+	std::map<std::string_view, int> m_holders; // Number of shared holders or -1 if held exclusively
+
+	static auto merge(std::span<const ResourceLock> suiteLocks, std::span<const ResourceLock> testCaseLocks) -> std::map<std::string_view, ResourceAccess>
+	{
+		auto result = std::map<std::string_view, ResourceAccess>{{"", ResourceAccess::Shared}};
+
+		for(const auto& locks : {suiteLocks, testCaseLocks})
+		{
+			for(const auto& lock : locks)
+			{
+				auto& access = result[lock.name];
+				access = std::max(access, lock.access);
+			}
+		}
+
+		return result;
+	}
+};
+
+class TestSuiteInterface{
+public:
+	virtual ~TestSuiteInterface() = default;
+	virtual void executeAll(TestExecutor& executor, ResultLogger& logger) const = 0;
+	virtual void executeTestCase(TestExecutor& executor, std::string_view name, ResultLogger& logger) const = 0;
+	virtual auto executeTestCase(TestExecutor& executor, std::size_t index, ResultLogger& logger) const -> TestCaseResult = 0;
+	virtual auto runTestCase(TestExecutor& executor, std::size_t index, ResultLogger& logger) const -> TestCaseResult = 0;
+	virtual auto name() const -> std::string_view = 0;
+	virtual auto sourceFile() const -> std::string_view = 0;
+	virtual auto testCaseName(std::size_t index) const -> std::string_view = 0;
+	virtual auto numTestCases() const -> std::size_t = 0;
+	virtual auto resourceLocks() const -> std::span<const ResourceLock> = 0;
+	virtual auto testCaseResourceLocks(std::size_t index) const -> std::span<const ResourceLock> = 0;
+	virtual auto serializeTestCase(std::size_t index, std::string& out) const -> bool = 0;
+	virtual auto executeSerializedTestCase(TestExecutor& executor, std::string_view name, std::string_view args, ResultLogger& logger) const -> TestCaseResult = 0;
+};
+using TestSuitePtr = std::unique_ptr<TestSuiteInterface>;
+
+// Everything that does not depend on the signature of the test function so it is only compiled once
+class TestSuiteBase : public TestSuiteInterface{
+public:
+	TestSuiteBase(std::string testName, std::source_location location)
+		: m_testName{std::move(testName)}
+		, m_location{location}
+	{
+	}
+
+	TestSuiteBase(const TestSuiteBase&) = delete;
+	TestSuiteBase& operator=(const TestSuiteBase&) = delete;
+
+	void executeAll(TestExecutor& executor, ResultLogger& logger) const override
+	{
+		if(numTestCases() == 0)
+			throwException(std::logic_error("Test suite '" + m_testName + "' does not have any test cases"));
+
+		for(std::size_t i = 0; i < numTestCases(); ++i)
+			executeTestCase(executor, i, logger);
+	}
+
+	void executeTestCase(TestExecutor& executor, std::string_view name, ResultLogger& logger) const override
+	{
+		for(std::size_t i = 0; i < numTestCases(); ++i)
+		{
+			if(testCaseName(i) == name)
+			{
+				executeTestCase(executor, i, logger);
+				return;
+			}
+		}
+
+		throwException(std::logic_error("Test case '" + std::string(name) + "' does not exist in test suite '" + m_testName + "'"));
+	}
+
+	auto executeTestCase(TestExecutor& executor, std::size_t index, ResultLogger& logger) const -> TestCaseResult override
+	{
+		const auto result = runTestCase(executor, index, logger);
+		executor.addResult(m_testName, result.passed);
+		return result;
+	}
+
+	auto runTestCase(TestExecutor& executor, std::size_t index, ResultLogger& logger) const -> TestCaseResult override
+	{
+		return executor.run(m_testName, testCaseName(index), [this, index](){ invoke(index); }, logger);
+	}
+
+	auto executeSerializedTestCase(TestExecutor& executor, std::string_view name, std::string_view args, ResultLogger& logger) const -> TestCaseResult override
+	{
+		return executor.execute(m_testName, name, [this, args](){ invokeSerialized(args); }, logger);
+	}
+
+	auto name() const -> std::string_view override{ return m_testName; }
+	auto sourceFile() const -> std::string_view override{ return m_location.file_name(); }
+	auto resourceLocks() const -> std::span<const ResourceLock> override{ return m_resourceLocks; }
+
+protected:
+	std::vector<ResourceLock> m_resourceLocks;
+
+	virtual void invoke(std::size_t index) const = 0;
+	virtual void invokeSerialized(std::string_view args) const = 0;
+
+private:
+	std::string          m_testName;
+	std::source_location m_location;
+};
+
+// Test case of a constexpr table that is referenced by the test suite instead of being copied
+template<typename ...Args>
+struct ConstantTestCase{
+	std::string_view                  name;
+	std::tuple<std::decay_t<Args>...> args;
+};
+
+template<typename ...Args>
+class TestSuite : public TestSuiteBase{
+public:
+	using TestFunc  = std::function<void(Args...)>;
+	using TupleType = std::tuple<std::decay_t<Args>...>;
+
+	struct TestCase{
+		std::string               name;
+		TupleType                 args;
+		std::vector<ResourceLock> resourceLocks = {};
+	};
+
+	using ConstantTestCase = test::ConstantTestCase<Args...>;
+
+	TestSuite(std::string testName, TestFunc testFunc, std::source_location location = std::source_location::current())
+		: TestSuiteBase{std::move(testName), location}
+		, m_testFunc{std::forward<TestFunc>(testFunc)}
+	{
+	}
+
+	void addTestCase(std::string name, Args&&... args)
+	{
+		m_testCases.push_back({std::move(name), TupleType(std::forward<Args>(args)...)});
+	}
+
+	void addTestCases(std::initializer_list<TestCase> testCases)
+	{
+		m_testCases.reserve(m_testCases.size() + testCases.size());
+
+		for(auto& t : testCases)
+			m_testCases.push_back(std::move(t));
+	}
+
+	// The table is not copied and has to outlive the test suite, typically a static constexpr array
+	void addConstantTestCases(std::span<const ConstantTestCase> testCases)
+	{
+		m_constantTestCases.push_back(testCases);
+		m_numConstantTestCases += testCases.size();
+	}
+
+	auto operator()(std::initializer_list<TestCase> testCases) -> TestSuite&
+	{
+		addTestCases(testCases);
+		return *this;
+	}
+
+	auto lock(ResourceLock resourceLock) -> TestSuite&
+	{
+		m_resourceLocks.push_back(std::move(resourceLock));
+		return *this;
+	}
+
+	auto numTestCases() const -> std::size_t override{ return m_testCases.size() + m_numConstantTestCases; }
+
+	auto testCaseName(std::size_t index) const -> std::string_view override
+	{
+		if(index < m_testCases.size())
+			return m_testCases[index].name;
+
+		return constantTestCase(index).name;
+	}
+
+	auto testCaseResourceLocks(std::size_t index) const -> std::span<const ResourceLock> override
+	{
+		if(index < m_testCases.size())
+			return m_testCases[index].resourceLocks;
+
+		return {};
+	}
+
+	auto serializeTestCase(std::size_t index, std::string& out) const -> bool override
+	{
+		if constexpr((Serializable<std::decay_t<Args>> && ...))
+		{
+			std::apply([&out](const auto&... args){ (Serializer<std::decay_t<Args>>::write(out, args), ...); }, testCaseArgs(index));
+			return true;
+		}
+		else
+		{
+			(void)index;
+			(void)out;
+			return false;
+		}
+	}
+
+protected:
+	void invoke(std::size_t index) const override
+	{
+		std::apply(m_testFunc, testCaseArgs(index));
+	}
+
+	void invokeSerialized(std::string_view args) const override
+	{
+		if constexpr((Serializable<std::decay_t<Args>> && ...))
+		{
+			// Braced initialization guarantees the arguments are read in order
+			auto tuple = TupleType{Serializer<std::decay_t<Args>>::read(args)...};
+			std::apply(m_testFunc, tuple);
+		}
+		else
+		{
+			(void)args;
+			throwException(std::logic_error("Arguments of test suite '" + std::string(name()) + "' cannot be deserialized"));
+		}
+	}
+
+private:
+	TestFunc                                       m_testFunc;
+	std::vector<TestCase>                          m_testCases;
+	std::vector<std::span<const ConstantTestCase>> m_constantTestCases;
+	std::size_t                                    m_numConstantTestCases = 0;
+
+	auto constantTestCase(std::size_t index) const -> const ConstantTestCase&
+	{
+		index -= m_testCases.size();
+
+		for(const auto& testCases : m_constantTestCases)
+		{
+			if(index < testCases.size())
+				return testCases[index];
+
+			index -= testCases.size();
+		}
+
+		throwException(std::out_of_range("Test case index out of range in test suite '" + std::string(name()) + "'"));
+	}
+
+	auto testCaseArgs(std::size_t index) const -> const TupleType&
+	{
+		if(index < m_testCases.size())
+			return m_testCases[index].args;
+
+		return constantTestCase(index).args;
+	}
+};
+
+template<typename ...Types>
+struct TypeList{};
+
+template<typename T>
+constexpr auto typeName() -> std::string_view
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	constexpr auto signature = std::string_view(__FUNCSIG__);
+	constexpr auto begin     = signature.find("typeName<") + 9;
+	constexpr auto end       = signature.rfind(">(void)");
+#else
+	// Types may contain brackets but no semicolons, which separate further template bindings on GCC
+	constexpr auto signature = std::string_view(__PRETTY_FUNCTION__);
+	constexpr auto begin     = signature.find("T = ") + 4;
+	constexpr auto end       = signature.find(';', begin) != std::string_view::npos ? signature.find(';', begin) : signature.rfind(']');
+#endif
+	return signature.substr(begin, end - begin);
+}
+
+// One test suite per type sharing the test cases. All suites have the same signature so only the call into the
+// templated test function is instantiated per type.
+template<typename ...Args>
+class TypedTestSuite{
+public:
+	using Suite    = TestSuite<Args...>;
+	using TestCase = typename Suite::TestCase;
+
+	explicit TypedTestSuite(std::vector<Suite*> testSuites)
+		: m_testSuites{std::move(testSuites)}
+	{
+	}
+
+	void addTestCase(std::string name, Args&&... args)
+	{
+		for(auto* testSuite : m_testSuites)
+			testSuite->addTestCase(name, Args(args)...);
+	}
+
+	void addTestCases(std::initializer_list<TestCase> testCases)
+	{
+		for(auto* testSuite : m_testSuites)
+			testSuite->addTestCases(testCases);
+	}
+
+	void addConstantTestCases(std::span<const typename Suite::ConstantTestCase> testCases)
+	{
+		for(auto* testSuite : m_testSuites)
+			testSuite->addConstantTestCases(testCases);
+	}
+
+	auto operator()(std::initializer_list<TestCase> testCases) -> TypedTestSuite&
+	{
+		addTestCases(testCases);
+		return *this;
+	}
+
+	auto lock(const ResourceLock& resourceLock) -> TypedTestSuite&
+	{
+		for(auto* testSuite : m_testSuites)
+			testSuite->lock(resourceLock);
+
+		return *this;
+	}
+
+	template<typename T, typename F>
+	static auto createTestSuite(const std::string& name, const F& testFunc, std::source_location location) -> std::unique_ptr<Suite>
+	{
+		return std::make_unique<Suite>(
+			name + '<' + std::string(typeName<T>()) + '>',
+			[testFunc](Args... args){ testFunc.template operator()<T>(std::forward<Args>(args)...); },
+			location);
+	}
+
+private:
+	std::vector<Suite*> m_testSuites;
+};
+
+template<typename F>
+struct TypedTestFunc;
+
+template<typename C, typename R, typename ...Args>
+struct TypedTestFunc<R(C::*)(Args...) const>{
+	using TypedSuite = TypedTestSuite<Args...>;
+};
+
+template<typename C, typename R, typename ...Args>
+struct TypedTestFunc<R(C::*)(Args...)>{
+	using TypedSuite = TypedTestSuite<Args...>;
+};
+
+struct TestOptions{
+	int                                     numJobs = 1;
+	std::optional<std::chrono::nanoseconds> timeBudget;
+	std::filesystem::path                   historyFile;
+	std::optional<std::uint64_t>            seed;
+	std::filesystem::path                   failureDirectory;
+	std::filesystem::path                   replayFile;
+	double                                  flakyThreshold = 0.0;
+	int                                     numRetries     = 0;
+	bool                                    quarantine     = false;
+	std::vector<std::string>                pollutionVictims;
+	std::filesystem::path                   impactIndexFile;
+	std::filesystem::path                   changedFilesFile;
+	std::filesystem::path                   progressSocket;
+	bool                                    numaPinning   = true;
+	bool                                    isolate       = false;
+	bool                                    resourceUsage = false;
+	bool                                    benchmark     = false;
+	int                                     numColdStarts = 0;
+	std::filesystem::path                   machineProfileFile;
+	std::filesystem::path                   benchmarkReportFile;
+
+	static auto parse(int argc, const char* const* const argv) -> TestOptions
+	{
+		auto options = TestOptions();
+
+		for(int i = 1; i < argc; ++i)
+		{
+			const auto arg = std::string_view(argv[i]);
+
+			const auto value = [&]() -> std::string_view
+			{
+				if(++i == argc)
+					throwException(std::invalid_argument("Missing value for argument '" + std::string(arg) + "'"));
+
+				return argv[i];
+			};
+
+			if(arg == "--jobs" || arg == "-j")
+			{
+				options.numJobs = std::stoi(std::string(value()));
+
+				if(options.numJobs <= 0)
+					options.numJobs = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+			}
+			else if(arg == "--time-budget")
+			{
+				options.timeBudget = parseDuration(value());
+			}
+			else if(arg == "--history")
+			{
+				options.historyFile = value();
+			}
+			else if(arg == "--seed")
+			{
+				options.seed = std::stoull(std::string(value()));
+			}
+			else if(arg == "--record-failures")
+			{
+				options.failureDirectory = value();
+			}
+			else if(arg == "--replay")
+			{
+				options.replayFile = value();
+			}
+			else if(arg == "--flaky-threshold")
+			{
+				options.flakyThreshold = std::stod(std::string(value()));
+			}
+			else if(arg == "--retries")
+			{
+				options.numRetries = std::stoi(std::string(value()));
+			}
+			else if(arg == "--quarantine")
+			{
+				options.quarantine = true;
+			}
+			else if(arg == "--find-polluters")
+			{
+				options.pollutionVictims.emplace_back(value());
+			}
+			else if(arg == "--impact-index")
+			{
+				options.impactIndexFile = value();
+			}
+			else if(arg == "--changed-files")
+			{
+				options.changedFilesFile = value();
+			}
+			else if(arg == "--progress-socket")
+			{
+				options.progressSocket = value();
+			}
+			else if(arg == "--resource-usage")
+			{
+				options.resourceUsage = true;
+			}
+			else if(arg == "--no-numa")
+			{
+				options.numaPinning = false;
+			}
+			else if(arg == "--isolate")
+			{
+				options.isolate = true;
+			}
+			else if(arg == "--benchmark")
+			{
+				options.benchmark = true;
+			}
+			else if(arg == "--cold-start")
+			{
+				options.benchmark     = true;
+				options.numColdStarts = std::stoi(std::string(value()));
+			}
+			else if(arg == "--machine-profile")
+			{
+				options.machineProfileFile = value();
+			}
+			else if(arg == "--benchmark-report")
+			{
+				options.benchmarkReportFile = value();
+			}
+			else
+			{
+				throwException(std::invalid_argument("Unknown argument '" + std::string(arg) + "'"));
+			}
+		}
+
+		if(!options.changedFilesFile.empty() && options.impactIndexFile.empty())
+			throwException(std::invalid_argument("'--changed-files' requires '--impact-index'"));
+
+		if((options.timeBudget || options.flakyThreshold > 0.0) && options.historyFile.empty() && argc > 0)
+			options.historyFile = std::string(argv[0]) + ".history";
+
+		return options;
+	}
+
+	// Accepts a number with an optional unit of ms, s (default), m or h
+	static auto parseDuration(std::string_view str) -> std::chrono::nanoseconds
+	{
+		auto numChars = std::size_t(0);
+		const auto value = std::stod(std::string(str), &numChars);
+		const auto unit  = str.substr(numChars);
+
+		const auto seconds = [&]()
+		{
+			if(unit == "ms")
+				return value / 1000.0;
+			if(unit.empty() || unit == "s")
+				return value;
+			if(unit == "m")
+				return value * 60.0;
+			if(unit == "h")
+				return value * 3600.0;
+
+			throwException(std::invalid_argument("Invalid duration '" + std::string(str) + "'"));
+		}();
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(seconds));
+	}
+};
+
+// Outcome and duration of every test case from previous runs, persisted between runs in a text file
+class TestHistory{
+public:
+	static constexpr int maxOutcomes = 32;
+
+	struct Record{
+		std::int64_t             lastRun     = 0; // Seconds since the epoch
+		bool                     passed      = true;
+		std::chrono::nanoseconds duration    = {};
+		std::uint32_t            outcomes    = 0; // Bit i is set if the i-th most recent run passed
+		int                      numOutcomes = 0;
+
+		auto numPassed() const -> int
+		{
+			return std::popcount(numOutcomes < maxOutcomes ? outcomes & ((1u << numOutcomes) - 1) : outcomes);
+		}
+
+		auto passRate() const -> double
+		{
+			return numOutcomes > 0 ? static_cast<double>(numPassed()) / numOutcomes : 1.0;
+		}
+
+		// Consistently failing test cases are broken rather than flaky
+		auto isFlaky(double threshold) const -> bool
+		{
+			return numPassed() > 0 && passRate() < threshold;
+		}
+	};
+
+	void load(const std::filesystem::path& file)
+	{
+		auto stream = std::ifstream(file);
+		auto line   = std::string();
+
+		while(std::getline(stream, line))
+		{
+			auto fields     = std::istringstream(line);
+			auto record     = Record();
+			auto durationNs = std::int64_t(0);
+			auto name       = std::string();
+
+			if(fields >> record.lastRun >> record.passed >> durationNs >> record.outcomes >> record.numOutcomes && std::getline(fields >> std::ws, name))
+			{
+				record.duration = std::chrono::nanoseconds(durationNs);
+				m_records.insert_or_assign(std::move(name), record);
+			}
+		}
+	}
+
+	// Returns false if the file could not be written, which only loses the history of this run
+	[[nodiscard]] auto save(const std::filesystem::path& file) const -> bool
+	{
+		const auto tempFile = std::filesystem::path(file).concat(".tmp");
+		auto       ec       = std::error_code();
+
+		{
+			auto stream = std::ofstream(tempFile);
+
+			for(const auto& [name, record] : m_records)
+			{
+				stream << record.lastRun << ' ' << record.passed << ' ' << record.duration.count() << ' '
+				       << record.outcomes << ' ' << record.numOutcomes << ' ' << name << '\n';
+			}
+
+			if(!stream)
+			{
+				std::filesystem::remove(tempFile, ec);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(tempFile, file, ec);
+
+		if(ec)
+			std::filesystem::remove(tempFile, ec);
+
+		return !ec;
+	}
+
+	auto find(std::string_view testName, std::string_view testCaseName) const -> std::optional<Record>
+	{
+		const auto lock = std::lock_guard(m_mutex);
+		const auto it   = m_records.find(key(testName, testCaseName));
+
+		if(it == m_records.end())
+			return std::nullopt;
+
+		return it->second;
+	}
+
+	void record(std::string_view testName, std::string_view testCaseName, const TestCaseResult& result)
+	{
+		const auto now  = std::chrono::system_clock::now().time_since_epoch();
+		const auto lock = std::lock_guard(m_mutex);
+
+		auto& record    = m_records[key(testName, testCaseName)];
+		record.lastRun  = std::chrono::duration_cast<std::chrono::seconds>(now).count();
+		record.passed      = result.passed;
+		record.duration    = result.duration;
+		record.outcomes    = (record.outcomes << 1) | (result.passed ? 1u : 0u);
+		record.numOutcomes = std::min(record.numOutcomes + 1, maxOutcomes);
+	}
+
+private:
+	mutable std::mutex                         m_mutex;
+	std::map<std::string, Record, std::less<>> m_records;
+
+	static auto key(std::string_view testName, std::string_view testCaseName) -> std::string
+	{
+		return std::string(testName) + "::" + std::string(testCaseName);
+	}
+};
+
+// Maps test cases to the source files they executed, so a change only needs to rerun the test cases that touched it
+class ImpactIndex{
+public:
+	// One line per test case with its name and source files separated by tabs
+	void load(const std::filesystem::path& file)
+	{
+		auto stream = std::ifstream(file);
+
+		if(!stream)
+			throwException(std::runtime_error("Failed to read impact index '" + file.string() + "'"));
+
+		auto line = std::string();
+
+		while(std::getline(stream, line))
+		{
+			auto fields = std::istringstream(line);
+			auto name   = std::string();
+			auto files  = std::set<std::string>();
+
+			if(!std::getline(fields, name, '\t'))
+				continue;
+
+			for(auto sourceFile = std::string(); std::getline(fields, sourceFile, '\t');)
+				files.insert(std::move(sourceFile));
+
+			m_sourceFiles.insert_or_assign(std::move(name), std::move(files));
+		}
+	}
+
+	void save(const std::filesystem::path& file) const
+	{
+		const auto tempFile = std::filesystem::path(file).concat(".tmp");
+
+		{
+			auto stream = std::ofstream(tempFile);
+
+			for(const auto& [name, files] : m_sourceFiles)
+			{
+				stream << name;
+
+				for(const auto& sourceFile : files)
+					stream << '\t' << sourceFile;
+
+				stream << '\n';
+			}
+
+			if(!stream)
+				throwException(std::runtime_error("Failed to write impact index '" + tempFile.string() + "'"));
+		}
+
+		std::filesystem::rename(tempFile, file);
+	}
+
+	void add(std::string name, std::set<std::string> files)
+	{
+		m_sourceFiles.insert_or_assign(std::move(name), std::move(files));
+	}
+
+	// Test cases missing from the index are always affected since nothing is known about them
+	auto isAffected(std::string_view testName, std::string_view testCaseName, std::span<const std::string> changedFiles) const -> bool
+	{
+		const auto it = m_sourceFiles.find(std::string(testName) + "::" + std::string(testCaseName));
+
+		if(it == m_sourceFiles.end())
+			return true;
+
+		return std::ranges::any_of(it->second, [&](std::string_view sourceFile)
+		{
+			return std::ranges::any_of(changedFiles, [&](std::string_view changedFile){ return matches(sourceFile, changedFile); });
+		});
+	}
+
+	// One path per line as printed by 'git diff --name-only', relative paths match any source file path ending in them
+	static auto loadChangedFiles(const std::filesystem::path& file) -> std::vector<std::string>
+	{
+		auto stream = std::ifstream(file);
+
+		if(!stream)
+			throwException(std::runtime_error("Failed to read changed files '" + file.string() + "'"));
+
+		auto changedFiles = std::vector<std::string>();
+
+		for(auto line = std::string(); std::getline(stream, line);)
+		{
+			if(!line.empty())
+				changedFiles.push_back(std::filesystem::path(line).lexically_normal().string());
+		}
+
+		return changedFiles;
+	}
+
+private:
+	std::map<std::string, std::set<std::string>, std::less<>> m_sourceFiles;
+
+	static auto matches(std::string_view sourceFile, std::string_view changedFile) -> bool
+	{
+		if(!sourceFile.ends_with(changedFile))
+			return false;
+
+		return sourceFile.size() == changedFile.size() || changedFile.starts_with('/') || sourceFile[sourceFile.size() - changedFile.size() - 1] == '/';
+	}
+};
+
+#ifdef TEST_IMPACT_ANALYSIS
+// Set of the functions entered on the owning thread between begin and end. Everything reachable from the
+// instrumentation hooks must not be instrumented itself, so recording sticks to a fixed size open addressing table.
+class FunctionCoverage{
+public:
+	static constexpr int         capacityBits = 16;
+	static constexpr std::size_t capacity     = std::size_t(1) << capacityBits;
+
+	TEST_NO_INSTRUMENT static void enter(void* function)
+	{
+		if(auto* const coverage = active())
+			coverage->insert(function);
+	}
+
+	void begin()
+	{
+		std::ranges::fill(m_functions, nullptr);
+		m_numFunctions = 0;
+		active()       = this;
+	}
+
+	auto end() -> std::vector<void*>
+	{
+		active() = nullptr;
+
+		auto functions = std::vector<void*>();
+		functions.reserve(m_numFunctions);
+		std::ranges::copy_if(m_functions, std::back_inserter(functions), [](void* function){ return function != nullptr; });
+
+		return functions;
+	}
+
+private:
+	void*       m_functions[capacity] = {};
+	std::size_t m_numFunctions        = 0;
+
+	TEST_NO_INSTRUMENT static auto active() -> FunctionCoverage*&
+	{
+		thread_local auto* coverage = static_cast<FunctionCoverage*>(nullptr);
+		return coverage;
+	}
+
+	// Functions beyond the capacity are dropped, leaving one free slot to terminate the probing
+	TEST_NO_INSTRUMENT void insert(void* function)
+	{
+		const auto hash = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(function)) * 0x9e3779b97f4a7c15ull;
+
+		for(auto i = static_cast<std::size_t>(hash >> (64 - capacityBits));; i = (i + 1) & (capacity - 1))
+		{
+			if(m_functions[i] == function)
+				return;
+
+			if(m_functions[i] == nullptr)
+			{
+				if(m_numFunctions + 1 < capacity)
+				{
+					m_functions[i] = function;
+					++m_numFunctions;
+				}
+
+				return;
+			}
+		}
+	}
+};
+
+// Collects the functions executed by every test case and resolves them to source files once the run is over.
+// Test cases that run in a child process are not covered, so recording requires an executor that does not isolate.
+class ImpactRecorder{
+public:
+	void begin()
+	{
+		coverage().begin();
+	}
+
+	void end(std::string_view testName, std::string_view testCaseName)
+	{
+		const auto functions = coverage().end();
+		const auto lock      = std::lock_guard(m_mutex);
+
+		m_functions[std::string(testName) + "::" + std::string(testCaseName)].insert(functions.begin(), functions.end());
+	}
+
+	// Uses addr2line, so the test binary needs to be built with debug information
+	auto resolve() const -> ImpactIndex
+	{
+		auto addresses = std::map<std::string, std::map<std::uintptr_t, void*>>();
+
+		for(const auto& [name, functions] : m_functions)
+		{
+			for(void* const function : functions)
+			{
+				auto info = Dl_info();
+
+				if(dladdr(function, &info) == 0 || info.dli_fbase == nullptr)
+					continue;
+
+				// Position independent objects are resolved relative to their load address
+				const auto* const header = static_cast<const ElfW(Ehdr)*>(info.dli_fbase);
+				const auto        base   = header->e_type == ET_DYN ? reinterpret_cast<std::uintptr_t>(info.dli_fbase) : 0;
+				const auto        object = info.dli_fname && *info.dli_fname ? std::string(info.dli_fname) : std::string("/proc/self/exe");
+
+				addresses[object].emplace(reinterpret_cast<std::uintptr_t>(function) - base, function);
+			}
+		}
+
+		auto sourceFiles = std::map<void*, std::string>();
+
+		for(const auto& [object, objectAddresses] : addresses)
+			resolve(object, objectAddresses, sourceFiles);
+
+		auto index = ImpactIndex();
+
+		for(const auto& [name, functions] : m_functions)
+		{
+			auto files = std::set<std::string>();
+
+			for(void* const function : functions)
+			{
+				if(const auto it = sourceFiles.find(function); it != sourceFiles.end())
+					files.insert(it->second);
+			}
+
+			index.add(name, std::move(files));
+		}
+
+		return index;
+	}
+
+private:
+	std::mutex                             m_mutex;
+	std::map<std::string, std::set<void*>> m_functions;
+
+	static auto coverage() -> FunctionCoverage&
+	{
+		thread_local auto threadCoverage = std::make_unique<FunctionCoverage>();
+		return *threadCoverage;
+	}
+
+	static void resolve(const std::string& object, const std::map<std::uintptr_t, void*>& addresses, std::map<void*, std::string>& sourceFiles)
+	{
+		constexpr auto batchSize = std::size_t(256);
+
+		auto quotedObject = std::string("'");
+
+		for(const char c : object)
+			quotedObject += c == '\'' ? std::string("'\\''") : std::string(1, c);
+
+		quotedObject += '\'';
+
+		for(auto it = addresses.begin(); it != addresses.end();)
+		{
+			auto command = "addr2line -e " + quotedObject;
+			auto batch   = std::vector<void*>();
+
+			for(; it != addresses.end() && batch.size() < batchSize; ++it)
+			{
+				command += std::format(" {:#x}", it->first);
+				batch.push_back(it->second);
+			}
+
+			auto* const pipe = popen(command.c_str(), "r");
+
+			if(!pipe)
+				throwException(std::runtime_error("Failed to run addr2line"));
+
+			auto line = std::string();
+
+			for(void* const function : batch)
+			{
+				line.clear();
+
+				for(int c = std::fgetc(pipe); c != EOF && c != '\n'; c = std::fgetc(pipe))
+					line += static_cast<char>(c);
+
+				// Lines look like 'file:line' with an optional discriminator, '??' if there is no debug information
+				const auto sourceFile = line.substr(0, line.rfind(':'));
+
+				if(!sourceFile.empty() && !sourceFile.starts_with("??"))
+					sourceFiles.emplace(function, std::filesystem::path(sourceFile).lexically_normal().string());
+			}
+
+			if(pclose(pipe) != 0)
+				throwException(std::runtime_error("Failed to resolve functions in '" + object + "' with addr2line"));
+		}
+	}
+};
+#endif
+
+// Everything needed to rerun a single failed test case, the arguments are only present if they are serializable
+struct ReplayRecord{
+	static constexpr std::string_view magic = "TESTREPLAY1";
+
+	std::uint64_t              seed = 0;
+	std::string                testName;
+	std::string                testCaseName;
+	std::optional<std::string> args;
+
+	void save(const std::filesystem::path& file) const
+	{
+		auto data = std::string(magic);
+
+		Serializer<std::uint64_t>::write(data, seed);
+		Serializer<std::string>::write(data, testName);
+		Serializer<std::string>::write(data, testCaseName);
+		Serializer<bool>::write(data, args.has_value());
+
+		if(args)
+			Serializer<std::string>::write(data, *args);
+
+		auto stream = std::ofstream(file, std::ios::binary);
+		stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+		if(!stream)
+			throwException(std::runtime_error("Failed to write replay file '" + file.string() + "'"));
+	}
+
+	static auto load(const std::filesystem::path& file) -> ReplayRecord
+	{
+		auto stream = std::ifstream(file, std::ios::binary);
+		const auto data = std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		auto in = std::string_view(data);
+
+		if(!in.starts_with(magic))
+			throwException(std::runtime_error("'" + file.string() + "' is not a replay file"));
+
+		in.remove_prefix(magic.size());
+
+		auto record = ReplayRecord();
+		record.seed         = Serializer<std::uint64_t>::read(in);
+		record.testName     = Serializer<std::string>::read(in);
+		record.testCaseName = Serializer<std::string>::read(in);
+
+		if(Serializer<bool>::read(in))
+			record.args = Serializer<std::string>::read(in);
+
+		return record;
+	}
+
+	static auto fileName(std::string_view testName, std::string_view testCaseName) -> std::string
+	{
+		auto result = std::string(testName) + '.' + std::string(testCaseName) + ".replay";
+		std::ranges::replace_if(result, [](char c){ return !std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '_' && c != '-'; }, '_');
+		return result;
+	}
+};
+
+// NUMA nodes with CPUs as described by sysfs. The root directory can point to a fake tree to test topologies the
+// current machine does not have.
+class NumaTopology{
+public:
+	struct Node{
+		int              id = 0;
+		std::vector<int> cpus;
+	};
+
+	// Memory only nodes are left out, no nodes are found on systems without sysfs
+	static auto detect(const std::filesystem::path& root = "/sys/devices/system/node") -> NumaTopology
+	{
+		auto topology = NumaTopology();
+		auto ec       = std::error_code();
+
+		for(const auto& entry : std::filesystem::directory_iterator(root, ec))
+		{
+			const auto name = entry.path().filename().string();
+
+			if(!name.starts_with("node") || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), [](char c){ return std::isdigit(static_cast<unsigned char>(c)) != 0; }))
+				continue;
+
+			auto stream  = std::ifstream(entry.path() / "cpulist");
+			auto cpuList = std::string();
+
+			std::getline(stream, cpuList);
+
+			auto node = Node{std::stoi(name.substr(4)), parseCpuList(cpuList)};
+
+			if(!node.cpus.empty())
+				topology.m_nodes.push_back(std::move(node));
+		}
+
+		std::ranges::sort(topology.m_nodes, {}, &Node::id);
+
+		return topology;
+	}
+
+	// Parses the kernel's list format like '0-3,8-11'
+	static auto parseCpuList(std::string_view cpuList) -> std::vector<int>
+	{
+		auto cpus   = std::vector<int>();
+		auto ranges = std::istringstream(std::string(cpuList));
+
+		for(auto range = std::string(); std::getline(ranges, range, ',');)
+		{
+			auto first = 0;
+			auto last  = 0;
+			auto dash  = '\0';
+			auto parts = std::istringstream(range);
+
+			if(!(parts >> first))
+				continue;
+
+			if(!(parts >> dash >> last) || dash != '-')
+				last = first;
+
+			for(int cpu = first; cpu <= last; ++cpu)
+				cpus.push_back(cpu);
+		}
+
+		return cpus;
+	}
+
+	auto nodes() const -> std::span<const Node>{ return m_nodes; }
+	auto isNuma() const -> bool{ return m_nodes.size() > 1; }
+
+	// Restricts the calling thread to the CPUs of the node and makes it allocate from that node while it has memory left
+	static auto bindCurrentThread(const Node& node) -> bool
+	{
+#ifdef __linux__
+		constexpr auto bitsPerWord = sizeof(unsigned long) * 8;
+
+		auto cpuSet = cpu_set_t();
+		CPU_ZERO(&cpuSet);
+
+		for(const int cpu : node.cpus)
+			CPU_SET(cpu, &cpuSet);
+
+		unsigned long nodeMask[16] = {};
+
+		if(node.id < 0 || static_cast<std::size_t>(node.id) >= std::size(nodeMask) * bitsPerWord)
+			return false;
+
+		nodeMask[static_cast<std::size_t>(node.id) / bitsPerWord] |= 1ul << (static_cast<std::size_t>(node.id) % bitsPerWord);
+
+		return ::sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0 && ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodeMask, std::size(nodeMask) * bitsPerWord + 1) == 0;
+#else
+		static_cast<void>(node);
+		return false;
+#endif
+	}
+
+private:
+	std::vector<Node> m_nodes;
+};
+
+struct BenchmarkReport{
+	MachineProfile               machine;
+	std::vector<BenchmarkResult> results;
+
+	void save(const std::filesystem::path& file) const
+	{
+		auto stream = std::ofstream(file);
+
+		stream << "{\n\t\"machine\": " << machine.toJson() << ",\n\t\"benchmarks\": [";
+
+		for(std::size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& result = results[i];
+
+			stream << (i > 0 ? ",\n\t\t" : "\n\t\t")
+			       << std::format(R"({{"name": {}, "iterations": {}, "samples": {}, "median_ns": {}, "min_ns": {}, "max_ns": {})",
+			                      toJson(result.name), result.numIterations, result.samples.size(), result.median(), result.min(), result.max());
+
+			if(result.coldStart)
+			{
+				const auto numSamples = static_cast<double>(std::max<std::size_t>(result.samples.size(), 1));
+
+				stream << std::format(R"(, "cold_start": true, "minor_faults_per_call": {}, "major_faults_per_call": {})",
+				                      static_cast<double>(result.usage.minorFaults) / numSamples, static_cast<double>(result.usage.majorFaults) / numSamples);
+			}
+
+			stream << '}';
+		}
+
+		stream << "\n\t]\n}\n";
+
+		if(!stream)
+			throwException(std::runtime_error("Failed to write benchmark report '" + file.string() + "'"));
+	}
+};
+
+// Streams progress as newline delimited JSON datagrams to a local collector. Sends never block, events are dropped
+// while the collector is not keeping up or not listening, so reporting cannot slow down the test run.
+class ProgressReporter{
+public:
+	// The socket is not connected so a listener that is missing, not yet started or restarted during the run only
+	// loses the events sent while it is away instead of aborting the run
+	explicit ProgressReporter(const std::filesystem::path& socketPath)
+	{
+#if TEST_POSIX
+		m_address.sun_family = AF_UNIX;
+
+		const auto path = socketPath.string();
+
+		if(path.size() >= sizeof(m_address.sun_path))
+			throwException(std::invalid_argument("Progress socket path '" + path + "' is too long"));
+
+		std::memcpy(m_address.sun_path, path.c_str(), path.size() + 1);
+
+		m_socket = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+#else
+		throwException(std::runtime_error("Progress socket '" + socketPath.string() + "' is not supported on this platform"));
+#endif
+	}
+
+	ProgressReporter(const ProgressReporter&) = delete;
+	ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+	~ProgressReporter()
+	{
+#if TEST_POSIX
+		if(m_socket >= 0)
+			::close(m_socket);
+#endif
+	}
+
+	void start(std::size_t numTestCases)
+	{
+		m_numTestCases = numTestCases;
+		m_startTime    = std::chrono::steady_clock::now();
+
+		send(std::format(R"({{"event":"start","total":{}}})", numTestCases));
+	}
+
+	void testCaseFinished(std::string_view testName, std::string_view testCaseName, const TestCaseResult& result)
+	{
+		const auto numDone   = ++m_numDone;
+		const auto numFailed = result.passed ? m_numFailed.load() : ++m_numFailed;
+
+		const auto& usage = result.usage;
+
+		send(std::format(R"({{"event":"case","test":{},"case":{},"passed":{},"duration_ns":{},"minor_faults":{},"major_faults":{},)"
+		                 R"("voluntary_switches":{},"involuntary_switches":{},"block_in":{},"block_out":{},"done":{},"failed":{},"eta_ns":{}}})",
+			toJson(testName), toJson(testCaseName), result.passed, result.duration.count(), usage.minorFaults, usage.majorFaults,
+			usage.voluntaryContextSwitches, usage.involuntaryContextSwitches, usage.blockInputs, usage.blockOutputs, numDone, numFailed, eta(numDone).count()));
+	}
+
+	void testCaseSkipped(std::string_view testName, std::string_view testCaseName)
+	{
+		const auto numDone = ++m_numDone;
+
+		send(std::format(R"({{"event":"skip","test":{},"case":{},"done":{},"failed":{},"eta_ns":{}}})",
+			toJson(testName), toJson(testCaseName), numDone, m_numFailed.load(), eta(numDone).count()));
+	}
+
+	void finish()
+	{
+		const auto duration = std::chrono::nanoseconds(std::chrono::steady_clock::now() - m_startTime);
+
+		send(std::format(R"({{"event":"finish","done":{},"failed":{},"duration_ns":{},"dropped":{}}})",
+			m_numDone.load(), m_numFailed.load(), duration.count(), m_numDropped.load()));
+	}
+
+private:
+#if TEST_POSIX
+	sockaddr_un                           m_address      = {};
+#endif
+	int                                   m_socket       = -1;
+	std::size_t                           m_numTestCases = 0;
+	std::chrono::steady_clock::time_point m_startTime;
+	std::atomic<std::size_t>              m_numDone      = 0;
+	std::atomic<std::size_t>              m_numFailed    = 0;
+	std::atomic<std::size_t>              m_numDropped   = 0;
+
+	void send(std::string event)
+	{
+		event += '\n';
+
+#if TEST_POSIX
+		if(::sendto(m_socket, event.data(), event.size(), MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&m_address), sizeof(m_address)) < 0)
+			++m_numDropped;
+#endif
+	}
+
+	// Extrapolates the average time per test case so far to the remaining ones
+	auto eta(std::size_t numDone) const -> std::chrono::nanoseconds
+	{
+		const auto elapsed = std::chrono::nanoseconds(std::chrono::steady_clock::now() - m_startTime);
+		return elapsed / static_cast<std::int64_t>(std::max<std::size_t>(numDone, 1)) * static_cast<std::int64_t>(m_numTestCases - std::min(numDone, m_numTestCases));
+	}
+};
+
+class TestScheduler{
+public:
+	TestScheduler(const TestOptions& options, TestHistory& history)
+		: m_numJobs{std::max(options.numJobs, 1)}
+		, m_timeBudget{options.timeBudget}
+		, m_failureDirectory{options.failureDirectory}
+		, m_flakyThreshold{options.flakyThreshold}
+		, m_numRetries{options.numRetries}
+		, m_quarantine{options.quarantine}
+		, m_resourceUsage{options.resourceUsage}
+		, m_history{history}
+		, m_topology{options.numaPinning && m_numJobs > 1 ? NumaTopology::detect() : NumaTopology()}
+	{
+	}
+
+	// Called with the test and test case name, only test cases for which it returns true are run
+	using Filter = std::function<bool(std::string_view, std::string_view)>;
+
+	void select(Filter filter)
+	{
+		m_filter = std::move(filter);
+	}
+
+	void reportProgress(ProgressReporter& progress)
+	{
+		m_progress = &progress;
+	}
+
+#ifdef TEST_IMPACT_ANALYSIS
+	void recordImpact(ImpactRecorder& recorder)
+	{
+		m_impactRecorder = &recorder;
+	}
+#endif
+
+	void run(std::span<const TestSuitePtr> testSuites, TestExecutor& executor, ResultLogger& logger)
+	{
+		const auto numTestCases = std::transform_reduce(testSuites.begin(), testSuites.end(), std::size_t(0), std::plus(),
+			[](const TestSuitePtr& testSuite){ return testSuite->numTestCases(); });
+
+		m_pending.clear();
+		m_pending.reserve(numTestCases);
+
+		for(const auto& testSuite : testSuites)
+		{
+			if(testSuite->numTestCases() == 0)
+				throwException(std::logic_error("Test suite '" + std::string(testSuite->name()) + "' does not have any test cases"));
+
+			for(std::size_t i = 0; i < testSuite->numTestCases(); ++i)
+			{
+				if(!m_filter || m_filter(testSuite->name(), testSuite->testCaseName(i)))
+					m_pending.push_back({testSuite.get(), i});
+			}
+		}
+
+		if(m_filter)
+			logger.logImpactSelection(m_pending.size(), numTestCases);
+
+		if(m_flakyThreshold > 0.0)
+			classifyFlakyTestCases(logger);
+
+		if(m_timeBudget)
+			prioritize();
+
+		m_firstPending = 0;
+		m_startTime    = std::chrono::steady_clock::now();
+
+		if(m_progress)
+			m_progress->start(m_pending.size());
+
+		if(m_topology.isNuma())
+		{
+			logger.logNumaPlacement(m_topology.nodes().size());
+
+			// Workers are spread across the nodes round robin, the calling thread only waits to keep its affinity
+			auto workers = std::vector<std::jthread>();
+			workers.reserve(static_cast<std::size_t>(m_numJobs));
+
+			for(int i = 0; i < m_numJobs; ++i)
+			{
+				workers.emplace_back([this, &executor, &logger, &node = m_topology.nodes()[static_cast<std::size_t>(i) % m_topology.nodes().size()]]()
+				{
+					NumaTopology::bindCurrentThread(node);
+					work(executor, logger);
+				});
+			}
+		}
+		else
+		{
+			auto workers = std::vector<std::jthread>();
+			workers.reserve(static_cast<std::size_t>(m_numJobs) - 1);
+
+			for(int i = 1; i < m_numJobs; ++i)
+				workers.emplace_back([this, &executor, &logger](){ work(executor, logger); });
+
+			work(executor, logger);
+		}
+
+		if(m_progress)
+			m_progress->finish();
+	}
+
+private:
+	struct ScheduledTestCase{
+		const TestSuiteInterface* testSuite        = nullptr;
+		std::size_t               index            = 0;
+		bool                      started          = false;
+		bool                      flaky            = false;
+		int                       priority         = 0;
+		std::chrono::nanoseconds  expectedDuration = {};
+	};
+
+	int                                     m_numJobs;
+	std::optional<std::chrono::nanoseconds> m_timeBudget;
+	std::filesystem::path                   m_failureDirectory;
+	double                                  m_flakyThreshold;
+	int                                     m_numRetries;
+	bool                                    m_quarantine;
+	bool                                    m_resourceUsage;
+	TestHistory&                            m_history;
+	NumaTopology                            m_topology;
+	std::mutex                              m_mutex;
+	std::condition_variable                 m_resourcesReleased;
+	ResourceTracker                         m_resources;
+	std::vector<ScheduledTestCase>          m_pending;
+	std::size_t                             m_firstPending = 0;
+	std::chrono::steady_clock::time_point   m_startTime;
+	Filter                                  m_filter;
+	ProgressReporter*                       m_progress = nullptr;
+#ifdef TEST_IMPACT_ANALYSIS
+	ImpactRecorder*                         m_impactRecorder = nullptr;
+#endif
+
+	// Previously failed test cases come first, followed by new or changed ones and the rest, fastest first within each group
+	void prioritize()
+	{
+		auto lastModified = std::map<std::string_view, std::int64_t>();
+
+		for(auto& testCase : m_pending)
+		{
+			const auto record = m_history.find(testCase.testSuite->name(), testCase.testSuite->testCaseName(testCase.index));
+
+			if(!record)
+			{
+				testCase.priority = 1;
+				continue;
+			}
+
+			const auto sourceFile = testCase.testSuite->sourceFile();
+			auto [it, inserted]   = lastModified.try_emplace(sourceFile, 0);
+
+			if(inserted)
+			{
+				auto ec = std::error_code();
+				const auto time = std::filesystem::last_write_time(sourceFile, ec);
+
+				if(!ec)
+					it->second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::file_clock::to_sys(time).time_since_epoch()).count();
+			}
+
+			testCase.priority         = !record->passed ? 0 : (it->second > record->lastRun ? 1 : 2);
+			testCase.expectedDuration = record->duration;
+		}
+
+		std::ranges::stable_sort(m_pending, [](const ScheduledTestCase& a, const ScheduledTestCase& b)
+		{
+			return std::tie(a.priority, a.expectedDuration) < std::tie(b.priority, b.expectedDuration);
+		});
+	}
+
+	void recordFailure(const ScheduledTestCase& testCase, ResultLogger& logger) const
+	{
+		auto record = ReplayRecord{seed(), std::string(testCase.testSuite->name()), std::string(testCase.testSuite->testCaseName(testCase.index)), std::string()};
+
+		if(!testCase.testSuite->serializeTestCase(testCase.index, *record.args))
+			record.args.reset();
+
+		const auto file = m_failureDirectory / ReplayRecord::fileName(record.testName, record.testCaseName);
+
+		std::filesystem::create_directories(m_failureDirectory);
+		record.save(file);
+		logger.logReplayFile(record.testName, record.testCaseName, file);
+	}
+
+	void classifyFlakyTestCases(ResultLogger& logger)
+	{
+		for(auto& testCase : m_pending)
+		{
+			const auto testName     = testCase.testSuite->name();
+			const auto testCaseName = testCase.testSuite->testCaseName(testCase.index);
+			const auto record       = m_history.find(testName, testCaseName);
+
+			testCase.flaky = record && record->isFlaky(m_flakyThreshold);
+
+			if(testCase.flaky)
+				logger.logFlaky(testName, testCaseName, record->passRate());
+		}
+	}
+
+	// Flaky test cases are retried and optionally reported as quarantined instead of failing the run
+	auto runTestCase(const ScheduledTestCase& testCase, TestExecutor& executor, ResultLogger& logger) -> TestCaseResult
+	{
+		const auto testName     = testCase.testSuite->name();
+		const auto testCaseName = testCase.testSuite->testCaseName(testCase.index);
+
+#ifdef TEST_IMPACT_ANALYSIS
+		if(m_impactRecorder)
+			m_impactRecorder->begin();
+#endif
+
+		auto result = testCase.testSuite->runTestCase(executor, testCase.index, logger);
+		m_history.record(testName, testCaseName, result);
+
+		for(int attempt = 1; !result.passed && testCase.flaky && attempt <= m_numRetries; ++attempt)
+		{
+			logger.logRetry(testName, testCaseName, attempt);
+			result = testCase.testSuite->runTestCase(executor, testCase.index, logger);
+			m_history.record(testName, testCaseName, result);
+		}
+
+#ifdef TEST_IMPACT_ANALYSIS
+		if(m_impactRecorder)
+			m_impactRecorder->end(testName, testCaseName);
+#endif
+
+		executor.addResult(testName, result.passed, testCase.flaky && m_quarantine);
+
+		if(m_resourceUsage)
+			logger.logResourceUsage(testName, testCaseName, result.usage);
+
+		if(m_progress)
+			m_progress->testCaseFinished(testName, testCaseName, result);
+
+		return result;
+	}
+
+	auto exceedsTimeBudget(const ScheduledTestCase& testCase) const -> bool
+	{
+		return m_timeBudget && std::chrono::steady_clock::now() - m_startTime + testCase.expectedDuration > *m_timeBudget;
+	}
+
+	void work(TestExecutor& executor, ResultLogger& logger)
+	{
+		auto lock    = std::unique_lock(m_mutex);
+		auto skipped = std::vector<ScheduledTestCase>();
+
+		while(true)
+		{
+			while(m_firstPending < m_pending.size() && m_pending[m_firstPending].started)
+				++m_firstPending;
+
+			auto it = m_pending.begin() + static_cast<std::ptrdiff_t>(m_firstPending);
+
+			for(; it != m_pending.end(); ++it)
+			{
+				if(it->started)
+					continue;
+
+				if(exceedsTimeBudget(*it))
+				{
+					it->started = true;
+					skipped.push_back(*it);
+					continue;
+				}
+
+				if(m_resources.tryAcquire(it->testSuite->resourceLocks(), it->testSuite->testCaseResourceLocks(it->index)))
+					break;
+			}
+
+			if(!skipped.empty())
+			{
+				lock.unlock();
+
+				for(const auto& testCase : std::exchange(skipped, {}))
+				{
+					executor.skip(testCase.testSuite->name(), testCase.testSuite->testCaseName(testCase.index), "time budget exceeded", logger);
+
+					if(m_progress)
+						m_progress->testCaseSkipped(testCase.testSuite->name(), testCase.testSuite->testCaseName(testCase.index));
+				}
+
+				lock.lock();
+
+				if(it != m_pending.end())
+				{
+					m_resources.release(it->testSuite->resourceLocks(), it->testSuite->testCaseResourceLocks(it->index));
+					continue;
+				}
+			}
+
+			if(it == m_pending.end())
+			{
+				if(std::all_of(m_pending.begin() + static_cast<std::ptrdiff_t>(m_firstPending), m_pending.end(), [](const auto& t){ return t.started; }))
+					return;
+
+				m_resourcesReleased.wait(lock);
+				continue;
+			}
+
+			it->started = true;
+			const auto testCase = *it;
+
+			lock.unlock();
+			const auto result = runTestCase(testCase, executor, logger);
+
+			if(!result.passed && !m_failureDirectory.empty())
+				recordFailure(testCase, logger);
+			lock.lock();
+
+			m_resources.release(testCase.testSuite->resourceLocks(), testCase.testSuite->testCaseResourceLocks(testCase.index));
+			m_resourcesReleased.notify_all();
+		}
+	}
+};
+
+// Finds test cases that make a victim fail when they run before it in the same process. Every trial runs in a fresh
+// child process and candidates are bisected, so k polluters among n test cases take O(k log n) trials.
+class PolluterSearch{
+public:
+	explicit PolluterSearch(std::span<const TestSuitePtr> testSuites)
+	{
+		for(const auto& testSuite : testSuites)
+		{
+			for(std::size_t i = 0; i < testSuite->numTestCases(); ++i)
+				m_testCases.push_back({testSuite.get(), i});
+		}
+	}
+
+	// Returns the number of polluter-victim pairs found
+	auto run(std::span<const std::string> victimNames, ResultLogger& logger) const -> int
+	{
+		auto numPairs = 0;
+
+		for(const auto& victimName : victimNames)
+		{
+			const auto victim = find(victimName);
+
+			if(!passes({}, victim))
+			{
+				logger.logError(victim.testSuite->name(), victim.testSuite->testCaseName(victim.index), "Fails when run in isolation");
+				continue;
+			}
+
+			auto candidates = std::vector<TestCaseRef>();
+			std::ranges::copy_if(m_testCases, std::back_inserter(candidates), [&victim](const TestCaseRef& t){ return t != victim; });
+
+			auto polluters = std::vector<TestCaseRef>();
+			bisect(candidates, victim, polluters);
+
+			for(const auto& polluter : polluters)
+				logger.logPolluter(polluter.qualifiedName(), victim.qualifiedName());
+
+			numPairs += static_cast<int>(polluters.size());
+		}
+
+		return numPairs;
+	}
+
+private:
+	struct TestCaseRef{
+		const TestSuiteInterface* testSuite = nullptr;
+		std::size_t               index     = 0;
+
+		auto qualifiedName() const -> std::string
+		{
+			return std::string(testSuite->name()) + "::" + std::string(testSuite->testCaseName(index));
+		}
+
+		auto operator==(const TestCaseRef&) const -> bool = default;
+	};
+
+	std::vector<TestCaseRef> m_testCases;
+
+	auto find(std::string_view qualifiedName) const -> TestCaseRef
+	{
+		const auto it = std::ranges::find_if(m_testCases, [qualifiedName](const TestCaseRef& t){ return t.qualifiedName() == qualifiedName; });
+
+		if(it == m_testCases.end())
+			throwException(std::logic_error("Test case '" + std::string(qualifiedName) + "' does not exist"));
+
+		return *it;
+	}
+
+	void bisect(std::span<const TestCaseRef> candidates, const TestCaseRef& victim, std::vector<TestCaseRef>& polluters) const
+	{
+		if(candidates.empty() || passes(candidates, victim))
+			return;
+
+		if(candidates.size() == 1)
+		{
+			polluters.push_back(candidates.front());
+			return;
+		}
+
+		const auto half = candidates.size() / 2;
+		bisect(candidates.first(half), victim, polluters);
+		bisect(candidates.subspan(half), victim, polluters);
+	}
+
+#if TEST_POSIX
+	static auto passes(std::span<const TestCaseRef> before, const TestCaseRef& victim) -> bool
+	{
+		std::cout.flush();
+		std::cerr.flush();
+		(void)ScratchDirectories::root();
+
+		const auto pid = ::fork();
+
+		if(pid == 0)
+		{
+			if(const auto devNull = ::open("/dev/null", O_WRONLY); devNull >= 0)
+			{
+				::dup2(devNull, STDOUT_FILENO);
+				::dup2(devNull, STDERR_FILENO);
+			}
+
+			auto executor = TestExecutor();
+			auto logger   = ResultLogger();
+
+			for(const auto& testCase : before)
+				(void)testCase.testSuite->runTestCase(executor, testCase.index, logger);
+
+			const auto result = victim.testSuite->runTestCase(executor, victim.index, logger);
+			std::cout.flush();
+			::_exit(result.passed ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+
+		auto status = 0;
+		const auto waited = pid >= 0 && ::waitpid(pid, &status, 0) == pid;
+
+		// The child exits without cleaning up, this process runs no test cases itself so everything is the child's
+		ScratchDirectories::removeAll();
+
+		if(!waited)
+			throwException(std::runtime_error("Failed to run test cases in a child process"));
+
+		return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+	}
+#else
+	static auto passes(std::span<const TestCaseRef>, const TestCaseRef&) -> bool
+	{
+		throwException(std::logic_error("Searching for polluters requires fork()"));
+	}
+#endif
+};
+
+class TestApp{
+public:
+	template<typename F>
+	[[nodiscard]] auto& addTest(std::string name, F&& testFunc, std::source_location location = std::source_location::current())
+	{
+		auto* testSuite = new TestSuite(std::move(name), std::function(std::forward<F>(testFunc)), location);
+		auto  ptr       = TestSuitePtr(testSuite);
+		m_tests.push_back(std::move(ptr));
+		return *testSuite;
+	}
+
+	// The test function is evaluated in a static_assert when this is instantiated so any failing check breaks the
+	// build. It is registered with a single test case to also show up in the results at runtime.
+	template<typename F>
+	requires std::is_empty_v<F> && std::default_initializable<F> && std::invocable<F>
+	[[nodiscard]] auto& addConstexprTest(std::string name, F testFunc, std::source_location location = std::source_location::current())
+	{
+		static_assert((F()(), true), "Test function failed during constant evaluation");
+
+		auto& testSuite = addTest(std::move(name), testFunc, location);
+		testSuite.addTestCase("constexpr");
+		return testSuite;
+	}
+
+	// Registers the templated test function as 'name<T>' for every type T in the TypeList
+	template<typename Types, typename F>
+	[[nodiscard]] auto addTypedTest(std::string name, F&& testFunc, std::source_location location = std::source_location::current())
+	{
+		return addTypedTest(std::move(name), std::forward<F>(testFunc), location, Types());
+	}
+
+	// Benchmarks only run with --benchmark or --cold-start instead of the tests
+	template<std::invocable F>
+	void addBenchmark(std::string name, F benchmarkFunc)
+	{
+		m_benchmarks.push_back({name, benchmarkFunc, [name, benchmarkFunc]() mutable { return measure(name, benchmarkFunc); }});
+	}
+
+	auto main(int argc = 0, const char* const* const argv = nullptr) -> int
+	{
+#if TEST_EXCEPTIONS
+		try
+		{
+			return run(argc, argv);
+		}
+		catch(const std::exception& e)
 		{
 			std::cerr << "ERROR: " << e.what() << std::endl;
 			return EXIT_FAILURE;
 		}
-
-		return EXIT_SUCCESS;
+#else
+		return run(argc, argv);
+#endif
 	}
 
 private:
+	struct Benchmark{
+		std::string                      name;
+		std::function<void()>            func;
+		std::function<BenchmarkResult()> measure;
+	};
+
 	std::vector<TestSuitePtr> m_tests;
+	std::vector<Benchmark>    m_benchmarks;
+
+	auto run(int argc, const char* const* const argv) -> int
+	{
+		const auto options = TestOptions::parse(argc, argv);
+
+		if(options.seed)
+			RandomSeed::set(*options.seed);
+
+		if(!options.replayFile.empty())
+			return replay(options.replayFile);
+
+		if(options.benchmark)
+			return runBenchmarks(options);
+
+		if(!options.pollutionVictims.empty())
+		{
+			auto logger = ResultLogger();
+			return PolluterSearch(m_tests).run(options.pollutionVictims, logger) > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+		}
+
+		auto history = TestHistory();
+
+		if(!options.historyFile.empty())
+			history.load(options.historyFile);
+
+		auto executor  = TestExecutor(options.isolate);
+		auto logger    = ResultLogger();
+		auto scheduler = TestScheduler(options, history);
+
+		auto progress = std::optional<ProgressReporter>();
+
+		if(!options.progressSocket.empty())
+			scheduler.reportProgress(progress.emplace(options.progressSocket));
+
+		auto impactIndex  = ImpactIndex();
+		auto changedFiles = std::vector<std::string>();
+
+		if(!options.changedFilesFile.empty())
+		{
+			impactIndex.load(options.impactIndexFile);
+			changedFiles = ImpactIndex::loadChangedFiles(options.changedFilesFile);
+			scheduler.select([&](std::string_view testName, std::string_view testCaseName)
+			{
+				return impactIndex.isAffected(testName, testCaseName, changedFiles);
+			});
+		}
+#ifdef TEST_IMPACT_ANALYSIS
+		auto impactRecorder = ImpactRecorder();
+
+		if(!options.impactIndexFile.empty() && options.changedFilesFile.empty())
+		{
+			// The index would claim that isolated test cases depend on none of the code they ran in the child
+			if(executor.isolated())
+				throwException(std::invalid_argument("Recording an impact index requires exceptions and no --isolate"));
+
+			scheduler.recordImpact(impactRecorder);
+		}
+#else
+		if(!options.impactIndexFile.empty() && options.changedFilesFile.empty())
+			throwException(std::invalid_argument("Recording an impact index requires TEST_IMPACT_ANALYSIS and -finstrument-functions"));
+#endif
+
+		scheduler.run(m_tests, executor, logger);
+
+#ifdef TEST_IMPACT_ANALYSIS
+		if(!options.impactIndexFile.empty() && options.changedFilesFile.empty())
+			impactRecorder.resolve().save(options.impactIndexFile);
+#endif
+
+		const auto& results = executor.results();
+
+		logger.logSummary(results);
+
+		if(!options.historyFile.empty() && !history.save(options.historyFile))
+			logger.logWarning("Failed to write test history '" + options.historyFile.string() + "'");
+
+		if(results.numFailed() > 0)
+			return EXIT_FAILURE;
+
+		return EXIT_SUCCESS;
+	}
+
+	// Measures all benchmarks instead of running the tests. A benchmark that fails is reported and left out of the report.
+	auto runBenchmarks(const TestOptions& options) -> int
+	{
+		auto logger = ResultLogger();
+		auto report = BenchmarkReport();
+
+		report.machine = machineProfile(options, logger);
+		logger.logMachineProfile(report.machine);
+
+		auto numFailed = 0;
+
+		for(const auto& benchmark : m_benchmarks)
+		{
+			if(!runBenchmark(benchmark, options.numColdStarts, logger, report))
+				++numFailed;
+		}
+
+		if(!options.benchmarkReportFile.empty())
+			report.save(options.benchmarkReportFile);
+
+		return numFailed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	// Probing takes a while so the profile is cached per host. A cache that cannot be written only costs the next run
+	// another probe.
+	static auto machineProfile(const TestOptions& options, ResultLogger& logger) -> MachineProfile
+	{
+		const auto file = options.machineProfileFile.empty() ? MachineProfile::defaultFile() : options.machineProfileFile;
+
+		if(auto profile = MachineProfile::cached(file))
+			return *profile;
+
+		const auto profile = MachineProfile::probe();
+
+		if(!file.empty() && !profile.save(file))
+			logger.logWarning("Failed to write machine profile '" + file.string() + "'");
+
+		return profile;
+	}
+
+	static auto runBenchmark(const Benchmark& benchmark, int numColdStarts, ResultLogger& logger, BenchmarkReport& report) -> bool
+	{
+		const auto measure = [&]()
+		{
+			return numColdStarts > 0 ? measureColdStart(benchmark.name, benchmark.func, numColdStarts) : benchmark.measure();
+		};
+
+#if TEST_EXCEPTIONS
+		try
+		{
+			logger.logBenchmark(report.results.emplace_back(measure()));
+			return true;
+		}
+		catch(const TestFailure& e)
+		{
+			logger.logFailure("benchmark", benchmark.name, e);
+		}
+		catch(const std::exception& e)
+		{
+			logger.logError("benchmark", benchmark.name, std::string("Unhandled std::exception: ") + e.what());
+		}
+		catch(...)
+		{
+			logger.logError("benchmark", benchmark.name, "Unhandled unknown exception");
+		}
+
+		return false;
+#else
+		// Without exceptions a failing benchmark aborts the whole run
+		logger.logBenchmark(report.results.emplace_back(measure()));
+		return true;
+#endif
+	}
+
+	// Reruns a single recorded test case with the seed and arguments it failed with
+	auto replay(const std::filesystem::path& file) -> int
+	{
+		const auto record = ReplayRecord::load(file);
+		const auto it     = std::ranges::find_if(m_tests, [&record](const TestSuitePtr& t){ return t->name() == record.testName; });
+
+		if(it == m_tests.end())
+			throwException(std::logic_error("Test suite '" + record.testName + "' does not exist"));
+
+		RandomSeed::set(record.seed);
+
+		auto executor = TestExecutor();
+		auto logger   = ResultLogger();
+
+		if(record.args)
+			(*it)->executeSerializedTestCase(executor, record.testCaseName, *record.args, logger);
+		else
+			(*it)->executeTestCase(executor, record.testCaseName, logger);
+
+		logger.logSummary(executor.results());
+
+		return executor.results().numFailed() > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	template<typename F, typename ...Types>
+	auto addTypedTest(std::string name, F&& testFunc, std::source_location location, TypeList<Types...>)
+	{
+		using Func       = std::decay_t<F>;
+		using First      = std::tuple_element_t<0, std::tuple<Types...>>;
+		using TypedSuite = typename TypedTestFunc<decltype(&Func::template operator()<First>)>::TypedSuite;
+
+		const auto func       = Func(std::forward<F>(testFunc));
+		auto       testSuites = std::vector<typename TypedSuite::Suite*>();
+
+		const auto addTestSuite = [&]<typename T>()
+		{
+			auto testSuite = TypedSuite::template createTestSuite<T>(name, func, location);
+			testSuites.push_back(testSuite.get());
+			m_tests.push_back(std::move(testSuite));
+		};
+
+		(addTestSuite.template operator()<Types>(), ...);
+
+		return TypedSuite(std::move(testSuites));
+	}
 };
 
 }
+
+#ifdef TEST_IMPACT_ANALYSIS
+// Called by code compiled with -finstrument-functions, defined inline so every test binary including this header gets exactly one
+extern "C" TEST_NO_INSTRUMENT [[gnu::used]] inline void __cyg_profile_func_enter(void* function, void*)
+{
+	test::FunctionCoverage::enter(function);
+}
+
+extern "C" TEST_NO_INSTRUMENT [[gnu::used]] inline void __cyg_profile_func_exit(void*, void*)
+{
+}
+#endif
+
+#ifdef TEST_ISOLATED_HEAP
+// Routes allocations of isolated test cases to the IsolatedHeap, the remaining allocation functions forward to these by default
+void* operator new(std::size_t size)
+{
+	if(void* const ptr = test::IsolatedHeap::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__))
+		return ptr;
+
+	if(void* const ptr = std::malloc(size > 0 ? size : 1))
+		return ptr;
+
+	test::throwException(std::bad_alloc());
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	const auto align = static_cast<std::size_t>(alignment);
+
+	if(void* const ptr = test::IsolatedHeap::allocate(size, align))
+		return ptr;
+
+	if(void* const ptr = std::aligned_alloc(align, (std::max(size, std::size_t(1)) + align - 1) & ~(align - 1)))
+		return ptr;
+
+	test::throwException(std::bad_alloc());
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if(!test::IsolatedHeap::contains(ptr))
+		std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+	if(!test::IsolatedHeap::contains(ptr))
+		std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	::operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+	::operator delete(ptr, alignment);
+}
+#endif